@@ -0,0 +1,324 @@
+/*
+Glassy Dynamics Simulation Module: Batch
+Created by Joe Raso, Sat Oct 17 21:06:45 UTC 2026
+Copyright © 2019 Joe Raso, All rights reserved.
+*/
+
+#include "Batch.hpp"
+
+/* The batch of glasses ----------------------------------------------------- */
+
+GlassBatch::GlassBatch(double rho, double T, int nside, int K, int seed):
+    rho(rho), Nside(nside), K(K), time(0), cutoff(0), ntypes(0){
+    /* Sets up every replica the way Particles::Initialize and Glass do: the
+    particles on a cubic lattice, and gaussian velocities minus the
+    center-of-mass velocity, drawn for replica l from stream l+1 of the seed.
+    Then calculates the forces and thermalizes each replica to T. */
+    int xi, yi, zi, i, k, l, n;
+    N = Nside*Nside*Nside;
+    lengthscale = pow(rho, -1.0/3.0);
+    sidelength = lengthscale*Nside;
+    
+    // Interleaved (3 x N*K) particle arrays
+    positions = Matrix(3, N*K);
+    velocities = Matrix(3, N*K);
+    forces = Matrix(3, N*K);
+    r = positions.Data();
+    v = velocities.Data();
+    f = forces.Data();
+    kinetic_energy.assign(K, 0);
+    potential_energy.assign(K, 0);
+    
+    // The same lattice in every replica
+    n = 0;
+    for(zi=0;zi<Nside;zi++){
+       for(yi=0;yi<Nside;yi++){
+         for(xi=0;xi<Nside;xi++){
+            for(l=0;l<K;l++){
+                r[0][n*K+l] = lengthscale*(xi+0.5);
+                r[1][n*K+l] = lengthscale*(yi+0.5);
+                r[2][n*K+l] = lengthscale*(zi+0.5);
+            }
+            n++;
+         }
+       }
+    }
+    
+    // Velocities, one stream per replica, leaving the caller's generator as
+    // it was
+    chaos::State saved = chaos::save();
+    for(l=0;l<K;l++){
+        double cmv[3] = {0, 0, 0};
+        chaos::seed(seed, l+1);
+        for(i=0;i<N;i++){
+            for(k=0;k<3;k++){
+                v[k][i*K+l] = chaos::gaussian(0.0, 1.0);
+                cmv[k] += v[k][i*K+l];
+            }
+        }
+        for(k=0;k<3;k++){
+            for(i=0;i<N;i++){v[k][i*K+l] -= (cmv[k]/N);}
+        }
+    }
+    chaos::restore(saved);
+    
+    Mixture();
+    UpdateKinetic();
+    UpdateForces();
+    Thermalize(T);
+}
+
+void GlassBatch::Mixture(){
+    /* The Kob-Anderson mixture, as in Glass::Mixture: the last 20% of the
+    particles are B particles. */
+    int Na = int(0.8*N);
+    species.assign(N, 0);
+    for(int i=Na;i<N;i++){species[i] = 1;}
+    ntypes = 2;
+    double eps[2][2] = {{1.0, 1.5}, {1.5, 0.5}};
+    double sigma[2][2] = {{1.0, 0.8}, {0.8, 0.88}};
+    epsilon.resize(4); sigma2.resize(4);
+    for(int t=0;t<4;t++){
+        epsilon[t] = eps[t/2][t%2];
+        sigma2[t] = sigma[t/2][t%2]*sigma[t/2][t%2];
+    }
+    rcut2.assign(4, HUGE_VAL);
+    eshift.assign(4, 0);
+    return;
+}
+
+double GlassBatch::KE(){
+    /* Kinetic energy averaged over the replicas. */
+    double sum = 0;
+    for(int l=0;l<K;l++){sum += kinetic_energy[l];}
+    return sum/K;
+}
+
+double GlassBatch::PE(){
+    /* Potential energy averaged over the replicas. */
+    double sum = 0;
+    for(int l=0;l<K;l++){sum += potential_energy[l];}
+    return sum/K;
+}
+
+void GlassBatch::UpdateKinetic(){
+    /* Updates the kinetic energy of each replica from its velocities. */
+    int i, k, l;
+    double* vk;
+    kinetic_energy.assign(K, 0);
+    double* ke = &kinetic_energy[0];
+    for(k=0;k<3;k++){
+        vk = v[k];
+        for(i=0;i<N;i++){
+            for(l=0;l<K;l++){ke[l] += (24.0)*(vk[i*K+l]*vk[i*K+l]);}
+        }
+    }
+    return;
+}
+
+void GlassBatch::Thermalize(double Temp){
+    /* Rescales the velocities of each replica to the kinetic energy of an
+    ideal gas at temperature T, as in Particles::Thermalize. */
+    Profiler::Scope scope(Profiler::Thermostat);
+    int i, k, l;
+    double* vk;
+    std::vector<double> scale(K);
+    double KEnew = (0.5)*3*Temp*(N-1);
+    for(l=0;l<K;l++){scale[l] = sqrt( KEnew / kinetic_energy[l] );}
+    for(k=0;k<3;k++){
+        vk = v[k];
+        for(i=0;i<N;i++){
+            for(l=0;l<K;l++){vk[i*K+l] *= scale[l];}
+        }
+    }
+    UpdateKinetic();
+    return;
+}
+
+void GlassBatch::SetCutoff(double rc){
+    /* Truncates and shifts the pair potentials at rc (in units of the sigma
+    of each pair); rc = 0 restores the untruncated potential. Recalculates
+    the forces for the new potential. */
+    double s6;
+    cutoff = rc;
+    for(int t=0;t<ntypes*ntypes;t++){
+        if(rc > 0){
+            rcut2[t] = rc*rc*sigma2[t];
+            s6 = 1.0/(rc*rc*rc*rc*rc*rc);
+            eshift[t] = 4*epsilon[t]*s6*(s6-1);
+        } else {
+            rcut2[t] = HUGE_VAL;
+            eshift[t] = 0;
+        }
+    }
+    UpdateForces();
+    return;
+}
+
+void GlassBatch::UpdateForces(){
+    /* The force loop over every i<j pair, for all the replicas at once. The
+    rows are dealt out round-robin over the threads of the pool, each adding
+    into its own force buffer and energies (thread 0 uses f itself), and the
+    buffers are summed into f at the end, as in Particles::PairForces. */
+    Profiler::Scope scope(Profiler::Forces);
+    int nthreads = Pool::Size();
+    int M = N*K;
+    if(int(identity.size()) != N){
+        identity.resize(N);
+        for(int i=0;i<N;i++){identity[i] = i;}
+    }
+    if(nthreads > 1 && (buffers.Rows() != 3*(nthreads-1)
+                        || buffers.Columns() != M)){
+        buffers = Matrix(3*(nthreads-1), M);
+    }
+    energies.assign(nthreads*K, 0);
+    
+    Kernels::Table table = {ntypes, sidelength, &epsilon[0], &sigma2[0],
+                            &rcut2[0], &eshift[0]};
+    const int* type = &species[0];
+    
+    Pool::Parallel([&](int t){
+        int i, k;
+        double** force = (t==0) ? f : buffers.Data() + 3*(t-1);
+        for(k=0;k<3;k++){for(i=0;i<M;i++){force[k][i]=0;};};
+        for(i=t;i<N;i+=nthreads){
+            Kernels::Lanes(i, identity.data()+i+1, N-i-1, K, r, force, type,
+                           table, &energies[t*K]);
+        }
+    });
+    // Reducing the thread buffers into f, each thread taking a block of rows
+    if(nthreads > 1){
+        Pool::Parallel([&](int t){
+            int i, k, b;
+            double *fk, *bk;
+            for(b=0;b<nthreads-1;b++){
+                for(k=0;k<3;k++){
+                    fk = f[k];
+                    bk = buffers.Data()[3*b+k];
+                    for(i=(t*M)/nthreads;i<((t+1)*M)/nthreads;i++){
+                        fk[i] += bk[i];
+                    }
+                }
+            }
+        });
+    }
+    for(int l=0;l<K;l++){
+        potential_energy[l] = 0;
+        for(int t=0;t<nthreads;t++){potential_energy[l] += energies[t*K+l];}
+    }
+    Profiler::Count(Profiler::Evaluations, K);
+    Profiler::Count(Profiler::Pairs, K*(long(N)*(N-1)/2));
+    return;
+}
+
+/* Lockstep integration ----------------------------------------------------- */
+
+void VerletBatch::SetDirectory(std::string dir){
+    /* Puts the energy and correlator files in the given directory (with a
+    trailing "/"), under their default names. */
+    efilename = dir + "Energies.csv";
+    cfilename = dir + "Correlators.csv";
+    return;
+}
+
+void VerletBatch::SetCorrelators(int stride, int points){
+    /* Sets up the correlators to sample every stride steps of a Run. They
+    take the particles of every replica together, so they give the ensemble
+    averages directly. */
+    correlator.Setup(stride, points);
+    return;
+}
+
+void VerletBatch::Record(std::ofstream& energyfile){
+    /* Writes a line of replica-averaged energies. */
+    Profiler::Scope scope(Profiler::Energies);
+    energyfile << time << ", ";
+    energyfile << System->KE() << ", ";
+    energyfile << System->PE() << ", ";
+    energyfile << System->TotalEnergy() << std::endl;
+    return;
+}
+
+void VerletBatch::Equilibrate(double t, int Nthermalize){
+    /* Advances every replica for time=t, themostating each of them every
+    Nthermalize steps. Records into an energy file as it does. */
+    Profiler::Scope scope(Profiler::Equilibrate);
+    int m, n; int steps = int(t/dt);
+    int cycles = int(steps/Nrecord);
+    long s = 0;
+    time = System->Time();
+    std::ofstream energyfile;
+    energyfile.open(efilename, std::ios::app);
+    // File check-stop
+    if(!energyfile.is_open()){
+        std::cout << "Error opening energy file!" << std::endl;
+        exit(1);
+    }
+    for(m=0;m<cycles;m++){
+        for(n=0;n<Nrecord;n++){
+            Propigate(); s++;
+            if(s%Nthermalize==0){System->Thermalize(Temp);}
+        }
+        Record(energyfile);
+    }
+    energyfile.close();
+    System->setTime(time);
+    return;
+}
+
+void VerletBatch::Run(double t){
+    /* Advances every replica for time=t, without a thermostat, recording the
+    energies and sampling the correlators as it does. */
+    Profiler::Scope scope(Profiler::Run);
+    int m, n; int steps = int(t/dt);
+    int cycles = int(steps/Nrecord);
+    int M = System->Number()*System->Replicas();
+    time = System->Time();
+    std::ofstream energyfile;
+    energyfile.open(efilename, std::ios::app);
+    // File check-stop
+    if(!energyfile.is_open()){
+        std::cout << "Error opening energy file!" << std::endl;
+        exit(1);
+    }
+    for(m=0;m<cycles;m++){
+        for(n=0;n<Nrecord;n++){
+            if (recordcorr) {correlator.Step(System->r, System->v, M,
+                                             System->Length());};
+            Propigate();
+        }
+        Record(energyfile);
+    }
+    energyfile.close();
+    if (recordcorr && correlator.Active()) {correlator.Save(cfilename, dt);};
+    System->setTime(time);
+    return;
+}
+
+void VerletBatch::Propigate(){
+    /* Advances the velocity Verlet calculation one step, for every replica:
+    the same loops as Verlet::Propigate, over all N*K entries. */
+    Profiler::Scope scope(Profiler::Propigate);
+    Profiler::Count(Profiler::Steps, System->Replicas());
+    int i,k;
+    double dt2 = dt*dt;
+    int n = System->Number()*System->Replicas();
+    double *r, *v, *f;
+    for(k=0;k<3;k++){
+        r = System->r[k]; v = System->v[k]; f = System->f[k];
+        for(i=0;i<n;i++){
+            r[i] += v[i]*dt + 0.5*f[i]*dt2;
+            v[i] += 0.5*f[i]*dt;
+        }
+    }
+    System->UpdateForces();
+    for(k=0;k<3;k++){
+        v = System->v[k]; f = System->f[k];
+        for(i=0;i<n;i++){
+            v[i] += 0.5*dt*f[i];
+        }
+    }
+    System->UpdateKinetic();
+    time += dt;
+    return;
+}
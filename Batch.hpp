@@ -0,0 +1,119 @@
+/*
+Glassy Dynamics Simulation Module: Batch
+Created by Joe Raso, Sat Oct 17 21:06:45 UTC 2026
+Copyright © 2019 Joe Raso, All rights reserved.
+
+This module contains "GlassBatch", K replicas of the Kob-Anderson glass stored
+side by side, and "VerletBatch", which integrates all of them in lockstep. The
+particle arrays are interleaved by replica: r[k][i*K+l] is component k of
+particle i in replica l. Every replica has the same species at the same index,
+so one pair (i, j) is the same pair in all of them, and the force loop can
+take it across the K replicas at once with contiguous vector loads (see
+Kernels::Lanes). For small systems this gets several times more replica
+steps per second out of a core than running the replicas one at a time.
+
+The replicas decorrelate as they run, so they don't share neighbors for long;
+the force loop therefore goes over every pair, and a cutoff only truncates the
+potential. That is the right trade for the small systems batches are meant
+for. Replica l draws its initial velocities from stream l+1 of the seed, like
+replica l of Protocol::Ensemble, and the recorded energies are averages over
+the replicas.
+*/
+
+#ifndef Batch_hpp
+#define Batch_hpp
+
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Correlator.hpp"
+#include "Kernels.hpp"
+#include "Matrix.hpp"
+#include "Pool.hpp"
+#include "Profiler.hpp"
+#include "chaos.hpp"
+
+class GlassBatch{
+    /* K interleaved replicas of the Kob-Anderson glass mixture */
+    public:
+        // Constructor
+        GlassBatch(double rho, double T, int nside, int K, int seed);
+        // Accessors. Each row holds N*K entries, replica fastest.
+        double** r;
+        double** v;
+        double** f;
+        inline int Number(){return N;};
+        inline int Replicas(){return K;};
+        inline double Length(){return sidelength;};
+        inline double Time(){return time;};
+        inline void setTime(double t){time = t;};
+        inline double Cutoff(){return cutoff;};
+        // Energies of replica l, and averaged over the replicas
+        inline double KE(int l){return kinetic_energy[l];};
+        inline double PE(int l){return potential_energy[l];};
+        double KE();
+        double PE();
+        inline double TotalEnergy(){return KE() + PE();};
+        // Common Operations
+        void UpdateKinetic();
+        void Thermalize(double Temp);
+        // Integration calculations
+        void UpdateForces();
+        void SetCutoff(double rc);
+    protected:
+        void Mixture();
+        Matrix positions, velocities, forces;
+        int N, Nside, K;
+        double lengthscale, sidelength, rho, time, cutoff;
+        std::vector<double> kinetic_energy, potential_energy;
+        // Species and the Lennard-Jones pair table, as in Particles
+        std::vector<int> species;
+        int ntypes;
+        std::vector<double> epsilon, sigma2, rcut2, eshift;
+        std::vector<int> identity;
+        // Per-thread force buffers and per-replica energies
+        Matrix buffers;
+        std::vector<double> energies;
+};
+
+class VerletBatch{
+    /* Velocity Verlet for all the replicas of a batch at once */
+    public:
+        // Constructor
+        VerletBatch(GlassBatch* system, double Temp, double dt, int Nrecord):
+            System(system), Temp(Temp), dt(dt), Nrecord(Nrecord), time(0),
+            efilename("Data/Energies.csv"), cfilename("Data/Correlators.csv"),
+            recordcorr(false) {};
+        // Accessors
+        inline double Temperature() {return Temp;};
+        inline void SetTemp(double T) {Temp = T;};
+        inline double Time() {return time;};
+        inline void SetTime(double t) {System->setTime(t);};
+        inline double Getdt() {return dt;};
+        inline void Setdt(double t) {dt = t;};
+        inline int GetRecord() {return Nrecord;};
+        inline void SetRecord(int n) {Nrecord = n;}
+        // Switches & Filenames
+        void SetDirectory(std::string dir);
+        inline void SetEnergyFile(std::string name) {efilename = name;};
+        inline void SetCorrelatorFile(std::string name) {cfilename = name;};
+        inline void RecordCorrelators(bool rc) {recordcorr = rc;};
+        void SetCorrelators(int stride, int points);
+        // Calculations
+        void Equilibrate(double t, int Nthermalize);
+        void Run(double t);
+        void Propigate();
+    protected:
+        void Record(std::ofstream& energyfile);
+        GlassBatch* System;
+        double Temp, dt;
+        int Nrecord;
+        double time;
+        std::string efilename, cfilename;
+        bool recordcorr;
+        Correlator correlator;
+};
+
+#endif /*Batch_hpp*/
@@ -0,0 +1,171 @@
+/*
+Glassy Dynamics Simulation Module: Cells
+Created by Joe Raso, Sat Oct 17 20:39:50 UTC 2026
+Copyright © 2019 Joe Raso, All rights reserved.
+*/
+
+#include "Cells.hpp"
+
+bool CellList::Setup(double L, double rmin){
+    /* Cuts the box into nside^3 cells of width >= rmin, and tabulates the
+    half-shell of neighboring cells for each one, along with the whole shell.
+    Three cells per side is the minimum for the half-shell to hold 13
+    distinct cells. */
+    int cx, cy, cz, dx, dy, dz, c, s;
+    sidelength = L;
+    nside = int(L/rmin);
+    if(rmin <= 0 || nside < 3){
+        nside = 0; ncell = 0; width = 0;
+        head.clear(); stencil.clear(); shell.clear();
+        return false;
+    }
+    ncell = nside*nside*nside;
+    width = L/nside;
+    head.assign(ncell, -1);
+    stencil.assign(13*ncell, 0);
+    shell.assign(27*ncell, 0);
+
+    for(cz=0;cz<nside;cz++){
+      for(cy=0;cy<nside;cy++){
+        for(cx=0;cx<nside;cx++){
+            c = cx + nside*(cy + nside*cz);
+            s = 0;
+            for(dz=0;dz<=1;dz++){
+              for(dy=-1;dy<=1;dy++){
+                for(dx=-1;dx<=1;dx++){
+                    // keep only the "forward" half of the 26 neighbors
+                    if(dz==0 && (dy<0 || (dy==0 && dx<=0))){continue;}
+                    stencil[13*c + s] = (cx+dx+nside)%nside
+                                      + nside*((cy+dy+nside)%nside
+                                      + nside*((cz+dz+nside)%nside));
+                    s++;
+                }
+              }
+            }
+            s = 0;
+            for(dz=-1;dz<=1;dz++){
+              for(dy=-1;dy<=1;dy++){
+                for(dx=-1;dx<=1;dx++){
+                    shell[27*c + s] = (cx+dx+nside)%nside
+                                    + nside*((cy+dy+nside)%nside
+                                    + nside*((cz+dz+nside)%nside));
+                    s++;
+                }
+              }
+            }
+        }
+      }
+    }
+    return true;
+}
+
+int CellList::Locate(double x, double y, double z){
+    /* Returns the index of the cell containing the point (x,y,z), wrapping
+    it back into the periodic box first (positions are never wrapped by the
+    integrators). */
+    double winv = 1.0/width;
+    int cx = int(std::floor(x*winv)) % nside;
+    int cy = int(std::floor(y*winv)) % nside;
+    int cz = int(std::floor(z*winv)) % nside;
+    if(cx<0){cx += nside;}
+    if(cy<0){cy += nside;}
+    if(cz<0){cz += nside;}
+    return cx + nside*(cy + nside*cz);
+}
+
+void CellList::Build(double** r, int N){
+    /* Bins all N particles into the cells as linked lists: head[c] is the
+    first particle in cell c, and next[i] the one after particle i. */
+    int i, c;
+    head.assign(ncell, -1);
+    next.resize(N);
+    for(i=N-1;i>=0;i--){
+        c = Locate(r[0][i], r[1][i], r[2][i]);
+        next[i] = head[c];
+        head[c] = i;
+    }
+    return;
+}
+
+void CellList::Move(int i, int from, int to){
+    /* Takes particle i out of the list of cell "from" and puts it at the
+    head of the list of cell "to". */
+    int j;
+    if(from == to){return;}
+    if(head[from] == i){
+        head[from] = next[i];
+    } else {
+        for(j=head[from];next[j]!=i;j=next[j]){}
+        next[j] = next[i];
+    }
+    next[i] = head[to];
+    head[to] = i;
+    return;
+}
+
+/* Verlet neighbor list ----------------------------------------------------- */
+
+bool NeighborList::Stale(double** r, int N){
+    /* Returns true if the list needs rebuilding: if it was never built, or
+    if the largest displacement since the last build is more than half the
+    skin. */
+    int i, k;
+    double d, r2, limit = 0.25*skin*skin;
+    calls++;
+    if(!valid || int(start.size()) != N+1){return true;}
+    for(i=0;i<N;i++){
+        r2 = 0;
+        for(k=0;k<3;k++){
+            d = r[k][i] - reference[k*N+i];
+            r2 += d*d;
+        }
+        if(r2 > limit){return true;}
+    }
+    return false;
+}
+
+double NeighborList::Moved(double** r, int N){
+    /* Returns the largest displacement of any particle since the last
+    build, or 0 if the list was never built for these N particles. */
+    int i, k;
+    double d, r2, largest = 0;
+    if(!valid || int(start.size()) != N+1){return 0;}
+    for(i=0;i<N;i++){
+        r2 = 0;
+        for(k=0;k<3;k++){
+            d = r[k][i] - reference[k*N+i];
+            r2 += d*d;
+        }
+        largest = std::max(largest, r2);
+    }
+    return sqrt(largest);
+}
+
+void NeighborList::Begin(double** r, int N){
+    /* Starts a new build, saving the current positions as the reference
+    for the displacement check. */
+    int i, k;
+    reference.resize(3*N);
+    for(k=0;k<3;k++){for(i=0;i<N;i++){reference[k*N+i] = r[k][i];}}
+    start.assign(N+1, 0);
+    pairs.clear();
+    return;
+}
+
+void NeighborList::Finish(){
+    /* Sorts the pairs added since Begin into the per-particle lists. */
+    int n, i;
+    int N = int(start.size()) - 1;
+    int npairs = int(pairs.size())/2;
+    // count neighbors per particle, then turn the counts into offsets
+    for(n=0;n<npairs;n++){start[pairs[2*n]+1]++;}
+    for(i=0;i<N;i++){start[i+1] += start[i];}
+    list.resize(npairs);
+    std::vector<int> fill(start.begin(), start.end()-1);
+    for(n=0;n<npairs;n++){list[fill[pairs[2*n]]++] = pairs[2*n+1];}
+    pairs.clear();
+    valid = true;
+    builds++;
+    listed += npairs;
+    return;
+}
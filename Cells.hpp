@@ -0,0 +1,95 @@
+/*
+Glassy Dynamics Simulation Module: Cells
+Created by Joe Raso, Sat Oct 17 20:39:50 UTC 2026
+Copyright © 2019 Joe Raso, All rights reserved.
+
+This module contains the linked-cell list used to find interacting pairs in
+O(N) time. The periodic box is cut into cubic cells at least as wide as the
+interaction range, so each particle only needs to be checked against the
+particles in its own cell and the 26 cells surrounding it. Only half of those
+neighbors (13) are stored, so every pair of cells is visited exactly once.
+
+It also contains the Verlet neighbor list: a per-particle list of the pairs
+within the interaction range plus a "skin". The list stays valid until some
+particle has moved more than half the skin, so it only has to be rebuilt
+every so many force evaluations.
+*/
+
+#ifndef Cells_hpp
+#define Cells_hpp
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+class CellList{
+    /* Linked-cell list for a periodic cubic box */
+    public:
+        // Constructor
+        CellList(): nside(0), ncell(0), width(0), sidelength(0) {};
+        // Sets up the cell grid for a box of length L, with cells no smaller
+        // than rmin. Returns false if the box is too small (< 3 cells/side).
+        bool Setup(double L, double rmin);
+        // Bins the particles into the cells, given the (3 x N) positions
+        void Build(double** r, int N);
+        // Accessors
+        inline bool Active(){return ncell > 0;};
+        inline int Side(){return nside;};
+        inline int Count(){return ncell;};
+        inline double Width(){return width;};
+        inline int Head(int c){return head[c];};
+        inline int Next(int i){return next[i];};
+        inline int Neighbor(int c, int s){return stencil[13*c + s];};
+        // The whole shell: cell c itself and all 26 around it (s < 27)
+        inline int Around(int c, int s){return shell[27*c + s];};
+        int Locate(double x, double y, double z);
+        // Moves particle i from cell "from" over to cell "to"
+        void Move(int i, int from, int to);
+    protected:
+        int nside, ncell;
+        double width, sidelength;
+        std::vector<int> head, next, stencil, shell;
+};
+
+class NeighborList{
+    /* Half neighbor list (each pair stored once, under its first particle)
+    stored as one flat array: the neighbors of i are list[start[i]] up to
+    list[start[i+1]]. */
+    public:
+        // Constructor
+        NeighborList(): skin(0), valid(false), builds(0), calls(0),
+            listed(0) {};
+        // Skin distance
+        inline void SetSkin(double s){skin = s; valid = false;};
+        inline double Skin(){return skin;};
+        inline bool Active(){return skin > 0;};
+        inline void Invalidate(){valid = false;};
+        // Checks whether any particle has moved more than skin/2 since the
+        // last build. Also counts the force evaluations served by the list.
+        bool Stale(double** r, int N);
+        // Largest displacement since the last build (0 if there is none),
+        // without counting a call
+        double Moved(double** r, int N);
+        // Building: Begin, Add each pair, then Finish
+        void Begin(double** r, int N);
+        inline void Add(int i, int j){pairs.push_back(i); pairs.push_back(j);};
+        void Finish();
+        // Accessors
+        inline int Start(int i){return start[i];};
+        inline int End(int i){return start[i+1];};
+        inline int Neighbor(int n){return list[n];};
+        inline const int* List(){return list.data();};
+        // Counters
+        inline long Builds(){return builds;};
+        inline long Calls(){return calls;};
+        inline double AverageLength(){
+            return builds>0 ? double(listed)/(builds*(start.size()-1)) : 0;};
+    protected:
+        double skin;
+        bool valid;
+        long builds, calls, listed;
+        std::vector<int> start, list, pairs;
+        std::vector<double> reference;
+};
+
+#endif /*Cells_hpp*/
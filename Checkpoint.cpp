@@ -0,0 +1,113 @@
+/*
+Glassy Dynamics Simulation Module: Checkpoint
+Created by Joe Raso, Sat Oct 17 20:59:08 UTC 2026
+Copyright © 2019 Joe Raso, All rights reserved.
+*/
+
+#include "Checkpoint.hpp"
+
+#include <cstdio>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool Checkpoint::Load(std::string path){
+    /* Reads the whole checkpoint into memory, ready for the stage it was
+    taken in to Get it back. */
+    FILE* in = fopen(path.c_str(), "rb");
+    if(in == 0){
+        std::cout << "Error opening checkpoint file " << path << "!"
+                  << std::endl;
+        return false;
+    }
+    char magic[8];
+    int64_t bytes = 0;
+    bool ok = fread(magic, 1, 8, in) == 8
+              && std::memcmp(magic, "GLSCHKP1", 8) == 0
+              && fread(&resume, sizeof(resume), 1, in) == 1
+              && fread(&cycle, sizeof(cycle), 1, in) == 1
+              && fread(&counter, sizeof(counter), 1, in) == 1
+              && fread(&bytes, sizeof(bytes), 1, in) == 1;
+    if(ok){
+        buffer.resize(bytes);
+        ok = fread(buffer.data(), 1, bytes, in) == size_t(bytes);
+    }
+    fclose(in);
+    if(!ok){
+        std::cout << "Error: " << path << " is not a whole checkpoint!"
+                  << std::endl;
+        resume = -1;
+        return false;
+    }
+    cursor = 0;
+    std::cout << "Resuming from stage " << resume << ", cycle " << cycle
+              << std::endl;
+    return true;
+}
+
+void Checkpoint::Begin(int cycle, long counter){
+    /* Starts a new checkpoint, to be taken at the given cycle of the current
+    stage. */
+    this->cycle = cycle;
+    this->counter = counter;
+    buffer.clear();
+    return;
+}
+
+void Checkpoint::Put(const void* data, size_t bytes){
+    const char* p = static_cast<const char*>(data);
+    buffer.insert(buffer.end(), p, p + bytes);
+    return;
+}
+
+void Checkpoint::Get(void* data, size_t bytes){
+    if(cursor + bytes > buffer.size()){
+        std::cout << "Error: checkpoint does not match this run!" << std::endl;
+        exit(1);
+    }
+    std::memcpy(data, buffer.data() + cursor, bytes);
+    cursor += bytes;
+    return;
+}
+
+void Checkpoint::Commit(){
+    /* Writes the checkpoint to a temporary file, and moves it over the old
+    one once it is safely on disk. */
+    std::string temp = filename + ".tmp";
+    FILE* out = fopen(temp.c_str(), "wb");
+    if(out == 0){
+        std::cout << "Error opening checkpoint file!" << std::endl;
+        exit(1);
+    }
+    int64_t bytes = buffer.size();
+    bool ok = fwrite("GLSCHKP1", 1, 8, out) == 8
+              && fwrite(&stage, sizeof(stage), 1, out) == 1
+              && fwrite(&cycle, sizeof(cycle), 1, out) == 1
+              && fwrite(&counter, sizeof(counter), 1, out) == 1
+              && fwrite(&bytes, sizeof(bytes), 1, out) == 1
+              && fwrite(buffer.data(), 1, bytes, out) == size_t(bytes)
+              && fflush(out) == 0 && fsync(fileno(out)) == 0;
+    ok = (fclose(out) == 0) && ok;
+    if(!ok || rename(temp.c_str(), filename.c_str()) != 0){
+        std::cout << "Error writing checkpoint file!" << std::endl;
+        exit(1);
+    }
+    return;
+}
+
+int64_t Checkpoint::Length(std::string path){
+    /* Length of the file in bytes, or -1 if there is no such file. */
+    struct stat info;
+    if(stat(path.c_str(), &info) != 0){return -1;}
+    return info.st_size;
+}
+
+void Checkpoint::Truncate(std::string path, int64_t length){
+    /* Cuts the file back to the given length (files that didn't exist, with
+    length -1, are left alone). */
+    if(length < 0){return;}
+    if(truncate(path.c_str(), length) != 0){
+        std::cout << "Error truncating " << path << "!" << std::endl;
+        exit(1);
+    }
+    return;
+}
@@ -0,0 +1,73 @@
+/*
+Glassy Dynamics Simulation Module: Checkpoint
+Created by Joe Raso, Sat Oct 17 20:59:08 UTC 2026
+Copyright © 2019 Joe Raso, All rights reserved.
+
+This module contains the checkpoint file, for restarting a protocol part way
+through. A protocol is a sequence of stages (each call of Run or Equilibrate
+is one), and the integrators save a checkpoint every so many recording cycles
+of a stage: the stage, the cycle, and whatever the integrator, the particle
+system and the random number generator write into it (see
+Integrator::SaveCheckpoint).
+
+On a resumed run the protocol starts over from the top, but the stages before
+the checkpointed one are skipped, and the checkpointed stage picks up from the
+saved state and cycle. The continuation is the same, bit for bit, as long as
+the same options (and number of threads) are used.
+
+A checkpoint is written to a temporary file, synced to disk and then renamed
+over the old one, so the file on disk is always a whole checkpoint, even if
+the run is killed in the middle of writing.
+*/
+
+#ifndef Checkpoint_hpp
+#define Checkpoint_hpp
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+class Checkpoint{
+    /* Stage bookkeeping and the checkpoint file */
+    public:
+        // Constructor
+        Checkpoint(): filename("Data/checkpoint.bin"), interval(0), stage(-1),
+            resume(-1), cycle(0), counter(0), cursor(0) {};
+        // Settings
+        inline void SetFile(std::string name){filename = name;};
+        inline void SetInterval(int cycles){interval = cycles;};
+        // Reads a checkpoint file to resume from. Returns false if it can't.
+        bool Load(std::string path);
+        // Stages: called as each stage starts. Stages before the checkpointed
+        // one are skipped; the checkpointed one is restored.
+        inline void NextStage(){stage++;};
+        inline bool Skipping(){return stage < resume;};
+        inline bool Restoring(){return stage == resume;};
+        inline int Cycle(){return int(cycle);};
+        inline long Counter(){return long(counter);};
+        // Whether a checkpoint is due at the end of cycle m of the stage
+        inline bool Due(int m){return interval > 0 && (m+1)%interval == 0;};
+        // Writing: Begin, Put the state, then Commit
+        void Begin(int cycle, long counter);
+        void Put(const void* data, size_t bytes);
+        template<class T> inline void Put(const T& x){Put(&x, sizeof(T));};
+        void Commit();
+        // Reading, in the same order as written
+        void Get(void* data, size_t bytes);
+        template<class T> inline void Get(T& x){Get(&x, sizeof(T));};
+        // File lengths, for putting output files back as they were
+        static int64_t Length(std::string path);
+        static void Truncate(std::string path, int64_t length);
+    protected:
+        std::string filename;
+        int interval;
+        // Current stage, and the stage, cycle and counter of the checkpoint
+        int32_t stage, resume;
+        int64_t cycle, counter;
+        std::vector<char> buffer;
+        size_t cursor;
+};
+
+#endif /*Checkpoint_hpp*/
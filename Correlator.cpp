@@ -0,0 +1,193 @@
+/*
+Glassy Dynamics Simulation Module: Correlator
+Created by Joe Raso, Sat Oct 17 20:53:27 UTC 2026
+Copyright © 2019 Joe Raso, All rights reserved.
+*/
+
+#include "Correlator.hpp"
+
+void Correlator::Setup(int stride, int points){
+    /* Sets the sampling interval (in steps) and the number of samples kept
+    per level, which has to be even. Clears anything accumulated so far. */
+    if(points < 2 || points%2 != 0){
+        std::cout << "Error: correlator points must be even!" << std::endl;
+        exit(1);
+    }
+    this->stride = stride;
+    this->points = points;
+    Reset();
+    return;
+}
+
+void Correlator::Reset(){
+    steps = 0; samples = 0; N = 0;
+    levels.clear();
+    return;
+}
+
+void Correlator::Sample(double** r, double** v, int n, double L,
+                        const int* ids){
+    /* Adds a sample of the (3 x N) positions and velocities to level 0, and
+    on up the levels it reaches, in the order of the ids if given. */
+    Profiler::Scope scope(Profiler::Correlators);
+    int i, k, q;
+    double phase;
+    // Tri's k-vectors
+    const double kn[3][3] = {{3,3,10},{6,-9,1},{9,-6,-1}};
+    if(n != N){Reset(); N = n;}
+    current.resize(12*N);
+    double* x = current.data();
+    for(k=0;k<3;k++){
+        if(ids){
+            for(i=0;i<N;i++){
+                x[k*N + ids[i]] = r[k][i];
+                x[(3+k)*N + ids[i]] = v[k][i];
+            }
+        } else {
+            std::copy(r[k], r[k]+N, x + k*N);
+            std::copy(v[k], v[k]+N, x + (3+k)*N);
+        }
+    }
+    for(q=0;q<3;q++){
+        double* c = x + (6+q)*N;
+        double* s = x + (9+q)*N;
+        for(i=0;i<N;i++){
+            phase = 0;
+            for(k=0;k<3;k++){phase += (2*M_PI/L)*kn[q][k]*x[k*N + i];}
+            c[i] = cos(phase);
+            s[i] = sin(phase);
+        }
+    }
+    // Level l takes every 2^l-th sample (only level 0 gets the first)
+    for(int l=0;samples%(1L<<l)==0;l++){
+        if(l == int(levels.size())){
+            Level level;
+            level.data.resize(size_t(points)*12*N);
+            level.newest = points - 1;
+            level.count = 0;
+            level.msd.assign(points, 0);
+            level.fsk.assign(points, 0);
+            level.cvv.assign(points, 0);
+            level.origins.assign(points, 0);
+            levels.push_back(level);
+        }
+        Push(l);
+        if((samples >> l) == 0){break;}
+    }
+    samples++;
+    return;
+}
+
+void Correlator::Push(int l){
+    /* Stores the current sample in level l, and correlates it with the ones
+    before it. Lags below p/2 are already covered by the level below. */
+    int i, j;
+    double d, msd, fsk, cvv;
+    Level& level = levels[l];
+    level.newest = (level.newest + 1)%points;
+    level.count++;
+    double* now = level.data.data() + size_t(level.newest)*12*N;
+    std::copy(current.begin(), current.end(), now);
+    int filled = (level.count < points) ? int(level.count) : points;
+    for(j=(l==0)?0:points/2;j<filled;j++){
+        double* then = level.data.data()
+                       + size_t((level.newest - j + points)%points)*12*N;
+        msd = 0; fsk = 0; cvv = 0;
+        for(i=0;i<3*N;i++){
+            d = now[i] - then[i];
+            msd += d*d;
+            cvv += now[3*N+i]*then[3*N+i];
+            // cos(k.r(t) - k.r(0))
+            fsk += now[6*N+i]*then[6*N+i] + now[9*N+i]*then[9*N+i];
+        }
+        level.msd[j] += msd;
+        level.fsk[j] += fsk;
+        level.cvv[j] += cvv;
+        level.origins[j]++;
+    }
+    return;
+}
+
+void Correlator::Save(std::string filename, double dt){
+    /* Writes the correlations accumulated so far, one line per lag in order
+    of increasing lag, overwriting the file. */
+    std::ofstream file;
+    file.open(filename);
+    // File check-stop
+    if(!file.is_open()){
+        std::cout << "Error opening correlator file!" << std::endl;
+        exit(1);
+    }
+    file.precision(10);
+    for(int l=0;l<int(levels.size());l++){
+        Level& level = levels[l];
+        for(int j=(l==0)?0:points/2;j<points;j++){
+            if(level.origins[j] == 0){continue;}
+            double norm = double(level.origins[j])*N;
+            file << double(j)*(1L<<l)*stride*dt << ", ";
+            file << level.msd[j]/norm << ", ";
+            file << level.fsk[j]/(3*norm) << ", ";
+            file << level.cvv[j]/norm << ", ";
+            file << level.origins[j] << std::endl;
+        }
+    }
+    file.close();
+    return;
+}
+
+void Correlator::Save(Checkpoint& out){
+    /* Puts the samples and sums of every level into the checkpoint. */
+    int32_t nlevels = int32_t(levels.size());
+    out.Put(stride);
+    out.Put(points);
+    out.Put(steps);
+    out.Put(samples);
+    out.Put(N);
+    out.Put(nlevels);
+    for(int l=0;l<nlevels;l++){
+        Level& level = levels[l];
+        out.Put(level.data.data(), sizeof(double)*level.data.size());
+        out.Put(level.newest);
+        out.Put(level.count);
+        out.Put(level.msd.data(), sizeof(double)*points);
+        out.Put(level.fsk.data(), sizeof(double)*points);
+        out.Put(level.cvv.data(), sizeof(double)*points);
+        out.Put(level.origins.data(), sizeof(long)*points);
+    }
+    return;
+}
+
+void Correlator::Load(Checkpoint& in){
+    /* Restores the state saved by Save, which has to have been sampling
+    with the same stride and points. */
+    int s, p;
+    int32_t nlevels;
+    in.Get(s);
+    in.Get(p);
+    if(s != stride || p != points){
+        std::cout << "Error: checkpoint correlators were set up differently!"
+                  << std::endl;
+        exit(1);
+    }
+    in.Get(steps);
+    in.Get(samples);
+    in.Get(N);
+    in.Get(nlevels);
+    levels.resize(nlevels);
+    for(int l=0;l<nlevels;l++){
+        Level& level = levels[l];
+        level.data.resize(size_t(points)*12*N);
+        level.msd.resize(points);
+        level.fsk.resize(points);
+        level.cvv.resize(points);
+        level.origins.resize(points);
+        in.Get(level.data.data(), sizeof(double)*level.data.size());
+        in.Get(level.newest);
+        in.Get(level.count);
+        in.Get(level.msd.data(), sizeof(double)*points);
+        in.Get(level.fsk.data(), sizeof(double)*points);
+        in.Get(level.cvv.data(), sizeof(double)*points);
+        in.Get(level.origins.data(), sizeof(long)*points);
+    }
+    return;
+}
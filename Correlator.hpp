@@ -0,0 +1,81 @@
+/*
+Glassy Dynamics Simulation Module: Correlator
+Created by Joe Raso, Sat Oct 17 20:53:27 UTC 2026
+Copyright © 2019 Joe Raso, All rights reserved.
+
+This module contains the multiple-tau correlator, which accumulates the MSD,
+the self-intermediate scattering function Fs(k,t) (averaged over Tri's three
+k-vectors, as in process.py) and the velocity autocorrelation Cvv while the
+simulation runs, so no trajectory has to be written to get them.
+
+Samples are kept in a hierarchy of levels. Level 0 holds the last p samples
+and correlates each new one against them, giving the lags 0 ... p-1. Every
+other sample that reaches a level is passed on to the next, so level l holds
+samples 2^l apart and supplies the lags p/2 * 2^l ... (p-1) * 2^l. The lags
+are spaced logarithmically, and both the memory and the work per sample grow
+only with the number of levels, log2(T/p). Samples are passed on as they are,
+not block averaged, so every lag is exact; the long lags just have fewer time
+origins.
+
+Positions are never wrapped back into the box, so displacements are taken
+directly, without the minimum image.
+*/
+
+#ifndef Correlator_hpp
+#define Correlator_hpp
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Checkpoint.hpp"
+#include "Profiler.hpp"
+
+class Correlator{
+    /* Multiple-tau MSD, Fs(k,t) and Cvv correlator */
+    public:
+        // Constructor
+        Correlator(): stride(0), points(16), steps(0), samples(0), N(0) {};
+        // Samples every stride steps (0 = off), with p = points per level
+        void Setup(int stride, int points);
+        void Reset();
+        inline bool Active(){return stride > 0;};
+        inline int Stride(){return stride;};
+        inline long Samples(){return samples;};
+        // Counts a step, sampling the (3 x N) positions and velocities of a
+        // box of length L if this step is due. Given the ids of the
+        // particles, each one is kept under its id, so the particles can be
+        // reordered between samples.
+        inline void Step(double** r, double** v, int n, double L,
+                         const int* ids = 0){
+            if(stride > 0 && steps++ % stride == 0){Sample(r, v, n, L, ids);}
+        };
+        void Sample(double** r, double** v, int n, double L,
+                    const int* ids = 0);
+        // Writes time lag, MSD, Fs(k,t), Cvv and the number of time origins,
+        // given the timestep
+        void Save(std::string filename, double dt);
+        // Checkpointing everything accumulated so far
+        void Save(Checkpoint& out);
+        void Load(Checkpoint& in);
+    protected:
+        struct Level {
+            std::vector<double> data; // the last p samples, ring ordered
+            int newest;               // slot of the newest sample
+            long count;               // samples received
+            // Sums over time origins and particles, by lag index
+            std::vector<double> msd, fsk, cvv;
+            std::vector<long> origins;
+        };
+        void Push(int l);
+        int stride, points;
+        long steps, samples;
+        int N;
+        // One sample: r and v (3N each), then cos and sin of k.r (3N each)
+        std::vector<double> current;
+        std::vector<Level> levels;
+};
+
+#endif /*Correlator_hpp*/
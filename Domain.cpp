@@ -0,0 +1,422 @@
+/*
+Glassy Dynamics Simulation Module: Domain
+Created by Joe Raso, Sat Oct 17 21:58:11 UTC 2026
+Copyright © 2019 Joe Raso, All rights reserved.
+*/
+
+#include "Domain.hpp"
+
+#ifdef GLASSIUS_MPI
+
+DomainGlass::DomainGlass(double rho, double T, double nside, double rc,
+                         double skin):
+    Glass(rho, T, nside), comm(MPI_COMM_WORLD), ghosts(0), split(false) {
+    /* Sets up the whole glass, then keeps the particles in this process's
+    slab. */
+    int i, k, m, t;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+    total = N;
+    if(rc <= 0 || skin <= 0){
+        std::cout << "Error: a system split over processes needs a cutoff"
+                  << " and a neighbor list skin!" << std::endl;
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    SetCutoff(rc);
+    SetSkin(skin);
+
+    // The slabs, which have to hold the halo and the margin on either side
+    double reach = 0;
+    for(t=0;t<ntypes*ntypes;t++){reach = std::max(reach, sqrt(rlist2[t]));}
+    width = sidelength/size;
+    lower = rank*width;
+    margin = skin;
+    halo = reach + margin;
+    if(size > 1 && width < halo + margin){
+        std::cout << "Error: slabs " << width << " wide are too thin for the"
+                  << " cutoff and skin (they need " << halo + margin << ");"
+                  << " use fewer processes!" << std::endl;
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    // The channels to the slabs below and above. With two processes both
+    // are the same one, and each ghost is only sent to it once.
+    if(size == 2){
+        dest.assign(1, 1 - rank);
+        source = dest;
+    } else if(size > 2){
+        dest.push_back((rank + size - 1)%size);
+        dest.push_back((rank + 1)%size);
+        source.push_back(dest[1]);
+        source.push_back(dest[0]);
+    }
+    sends.resize(dest.size());
+    outbox.resize(dest.size());
+    inbox.resize(dest.size());
+    received.assign(dest.size(), 0);
+
+    // The writer keeps a whole copy of the system to gather the output into
+    // (set up without drawing from the random numbers)
+    if(Writer()){
+        chaos::State state = chaos::save();
+        snapshot.reset(new Snapshot(rho, nside, &species[0]));
+        chaos::restore(state);
+    }
+
+    // Keeping only the particles in this slab
+    for(i=0,m=0;i<N;i++){
+        if(Owner(r[2][i]) != rank){continue;}
+        for(k=0;k<3;k++){
+            r[k][m] = r[k][i];
+            v[k][m] = v[k][i];
+            f[k][m] = f[k][i];
+        }
+        species[m] = species[i];
+        ids[m] = ids[i];
+        m++;
+    }
+    N = m;
+    home.assign(r[2], r[2]+N);
+    moved = 0;
+    split = true;
+    neighbors.Invalidate();
+    UpdateForces();
+    UpdateKinetic();
+}
+
+int DomainGlass::Owner(double z){
+    int p = int((z - sidelength*floor(z/sidelength))/width);
+    return (p < size) ? p : size - 1;
+}
+
+double DomainGlass::Offset(double z){
+    /* z relative to the middle of this slab, in the periodic box. */
+    double d = z - (lower + 0.5*width);
+    return d - sidelength*fastround(d/sidelength);
+}
+
+bool DomainGlass::Anywhere(bool flag){
+    int mine = flag ? 1 : 0, any = 0;
+    MPI_Allreduce(&mine, &any, 1, MPI_INT, MPI_LOR, comm);
+    return any != 0;
+}
+
+void DomainGlass::Check(bool bad, std::string error){
+    /* Every process has to stop together, and only the first one prints. */
+    if(Anywhere(bad)){
+        if(rank == 0){std::cout << "Error: " << error << "!" << std::endl;}
+        MPI_Barrier(comm);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    return;
+}
+
+void DomainGlass::Reserve(int n, int keep){
+    /* Makes the particle arrays at least n long, copying over the first keep
+    particles if they have to be moved. */
+    int i, k;
+    if(positions.Columns() >= n){return;}
+    int room = std::max(n, positions.Columns() + positions.Columns()/4);
+    Matrix arrays[3] = {Matrix(3, room), Matrix(3, room), Matrix(3, room)};
+    for(k=0;k<3;k++){
+        for(i=0;i<keep;i++){
+            arrays[0].Data()[k][i] = r[k][i];
+            arrays[1].Data()[k][i] = v[k][i];
+            arrays[2].Data()[k][i] = f[k][i];
+        }
+    }
+    positions = arrays[0];
+    velocities = arrays[1];
+    forces = arrays[2];
+    r = positions.Data();
+    v = velocities.Data();
+    f = forces.Data();
+    species.resize(room);
+    ids.resize(room);
+    return;
+}
+
+void DomainGlass::Trade(){
+    /* Swaps the outboxes for the inboxes over every channel: first how many
+    numbers are coming, then the numbers. */
+    int c, out, in;
+    for(c=0;c<int(dest.size());c++){
+        out = int(outbox[c].size());
+        MPI_Sendrecv(&out, 1, MPI_INT, dest[c], 0, &in, 1, MPI_INT,
+                     source[c], 0, comm, MPI_STATUS_IGNORE);
+        inbox[c].resize(in);
+        MPI_Sendrecv(outbox[c].data(), out, MPI_DOUBLE, dest[c], 1,
+                     inbox[c].data(), in, MPI_DOUBLE, source[c], 1, comm,
+                     MPI_STATUS_IGNORE);
+    }
+    return;
+}
+
+void DomainGlass::Borders(){
+    /* Checks that no particle is further than the margin out of its slab,
+    sends the particles within the halo of the bottom (top) face of the slab
+    down (up) as ghosts, and rebuilds the neighbor lists of the owned
+    particles with the ghosts included. */
+    Profiler::Scope scope(Profiler::Exchange);
+    int i, j, k, c, m, s, t;
+    double d, r2, out = 0;
+    bool low, high;
+    for(c=0;c<int(dest.size());c++){sends[c].clear(); outbox[c].clear();}
+    for(i=0;i<N;i++){
+        d = Offset(r[2][i]);
+        out = std::max(out, fabs(d) - 0.5*width);
+        low = d < halo - 0.5*width;
+        high = d > 0.5*width - halo;
+        if(size == 2 && (low || high)){sends[0].push_back(i);}
+        if(size > 2 && low){sends[0].push_back(i);}
+        if(size > 2 && high){sends[1].push_back(i);}
+    }
+    Check(out > margin, "a particle has gone further than the skin out of its"
+          " slab; use a larger skin");
+    for(c=0;c<int(dest.size());c++){
+        for(j=0;j<int(sends[c].size());j++){
+            i = sends[c][j];
+            for(k=0;k<3;k++){outbox[c].push_back(r[k][i]);}
+            outbox[c].push_back(species[i]);
+        }
+    }
+    Trade();
+
+    // The ghosts go after the owned particles, channel by channel
+    ghosts = 0;
+    for(c=0;c<int(dest.size());c++){
+        received[c] = int(inbox[c].size())/4;
+        ghosts += received[c];
+    }
+    Reserve(N + ghosts, N);
+    i = N;
+    for(c=0;c<int(dest.size());c++){
+        for(m=0;m<received[c];m++,i++){
+            for(k=0;k<3;k++){r[k][i] = inbox[c][4*m+k];}
+            species[i] = int(inbox[c][4*m+3]);
+            ids[i] = -1;
+        }
+    }
+
+    // The lists: pairs of owned particles in neighbors, pairs of an owned
+    // particle and a ghost in remote (under the owned one)
+    Profiler::Scope lists(Profiler::Neighbors);
+    double Linv = 1.0/sidelength;
+    int owned = N, n = N + ghosts;
+    neighbors.Begin(r, N);
+    remote.Begin(r, N);
+    auto near = [&](int a, int b){
+        t = species[a]*ntypes + species[b];
+        r2 = 0;
+        for(k=0;k<3;k++){
+            d = r[k][a] - r[k][b];
+            d -= sidelength*fastround(d*Linv);
+            r2 += d*d;
+        }
+        if(r2 < rlist2[t]){
+            if(b < owned && a < owned){neighbors.Add(a, b);}
+            else if(a < owned){remote.Add(a, b);}
+            else if(b < owned){remote.Add(b, a);}
+        }
+    };
+    if(cells.Active()){
+        cells.Build(r, n);
+        for(c=0;c<cells.Count();c++){
+            for(i=cells.Head(c);i>=0;i=cells.Next(i)){
+                for(j=cells.Next(i);j>=0;j=cells.Next(j)){near(i, j);}
+                for(s=0;s<13;s++){
+                    for(j=cells.Head(cells.Neighbor(c,s));j>=0;
+                        j=cells.Next(j)){near(i, j);}
+                }
+            }
+        }
+    } else {
+        for(i=0;i<n;i++){for(j=i+1;j<n;j++){near(i, j);}}
+    }
+    neighbors.Finish();
+    remote.Finish();
+    return;
+}
+
+void DomainGlass::Refresh(){
+    /* Sends the current positions of the ghosts picked out by the last
+    Borders, in the same order. */
+    Profiler::Scope scope(Profiler::Exchange);
+    int i, j, k, c, m;
+    for(c=0;c<int(dest.size());c++){
+        outbox[c].clear();
+        for(j=0;j<int(sends[c].size());j++){
+            i = sends[c][j];
+            for(k=0;k<3;k++){outbox[c].push_back(r[k][i]);}
+        }
+    }
+    Trade();
+    i = N;
+    for(c=0;c<int(dest.size());c++){
+        for(m=0;m<received[c];m++,i++){
+            for(k=0;k<3;k++){r[k][i] = inbox[c][3*m+k];}
+        }
+    }
+    return;
+}
+
+void DomainGlass::Migrate(){
+    /* When the lists look like going stale at the next step (judging by
+    how far the particles moved over the last one), or once any particle
+    has moved half the skin along z since the last migration, hands every
+    particle that has left this slab over to the slab it is in now, along
+    with its velocity, force, species and id. The lists are rebuilt at the
+    next force evaluation, which they mostly would have been anyway. */
+    Profiler::Scope scope(Profiler::Exchange);
+    int i, j, k, c, m, p;
+    double drift = 0, now, limit = 0.5*neighbors.Skin();
+    bool lost = false;
+    if(size == 1){return;}
+    for(i=0;i<N;i++){drift = std::max(drift, fabs(r[2][i] - home[i]));}
+    now = neighbors.Moved(r, N);
+    drift = std::max(drift, now + std::max(now - moved, 0.0));
+    moved = now;
+    if(!Anywhere(drift > limit)){return;}
+
+    // Packing up the particles leaving, and closing up the gaps they leave
+    for(c=0;c<int(dest.size());c++){outbox[c].clear();}
+    for(i=0,m=0;i<N;i++){
+        p = Owner(r[2][i]);
+        if(p == rank){
+            for(k=0;k<3;k++){
+                r[k][m] = r[k][i];
+                v[k][m] = v[k][i];
+                f[k][m] = f[k][i];
+            }
+            species[m] = species[i];
+            ids[m] = ids[i];
+            m++;
+            continue;
+        }
+        c = (p == dest[0]) ? 0 : 1;
+        lost = lost || (p != dest[0] && p != dest.back());
+        for(k=0;k<3;k++){outbox[c].push_back(r[k][i]);}
+        for(k=0;k<3;k++){outbox[c].push_back(v[k][i]);}
+        for(k=0;k<3;k++){outbox[c].push_back(f[k][i]);}
+        outbox[c].push_back(species[i]);
+        outbox[c].push_back(ids[i]);
+    }
+    N = m;
+    Check(lost, "a particle has moved past the next slab over");
+    Trade();
+
+    // Taking in the particles arriving
+    for(c=0;c<int(dest.size());c++){m += int(inbox[c].size())/11;}
+    Reserve(m, N);
+    for(c=0;c<int(dest.size());c++){
+        for(j=0;j<int(inbox[c].size());j+=11,N++){
+            for(k=0;k<3;k++){
+                r[k][N] = inbox[c][j+k];
+                v[k][N] = inbox[c][j+3+k];
+                f[k][N] = inbox[c][j+6+k];
+            }
+            species[N] = int(inbox[c][j+9]);
+            ids[N] = int(inbox[c][j+10]);
+        }
+    }
+    home.assign(r[2], r[2]+N);
+    moved = 0;
+    ghosts = 0;
+    neighbors.Invalidate();
+    remote.Invalidate();
+    return;
+}
+
+void DomainGlass::UpdateForces(){
+    /* The forces on the particles of this slab, and the potential energy of
+    the whole system. Before the system is split up, the forces of the whole
+    of it. */
+    if(!split){Glass::UpdateForces(); return;}
+    Profiler::Scope scope(Profiler::Forces);
+    int i, k, start;
+    if(Anywhere(neighbors.Stale(r, N))){Borders();} else {Refresh();}
+
+    Kernels::Table table = {ntypes, sidelength, &epsilon[0], &sigma2[0],
+                            &rcut2[0], &eshift[0]};
+    const int* type = &species[0];
+    double energy = 0, shared = 0;
+    // Zero out the forces, the ghosts' too (the kernels add to them)
+    for(k=0;k<3;k++){for(i=0;i<N+ghosts;i++){f[k][i]=0;};};
+    for(i=0;i<N;i++){
+        start = neighbors.Start(i);
+        energy += kernel(i, neighbors.List() + start, neighbors.End(i) - start,
+                         r, f, type, table);
+        start = remote.Start(i);
+        if(remote.End(i) == start){continue;}
+        shared += kernel(i, remote.List() + start, remote.End(i) - start, r,
+                         f, type, table);
+    }
+    // the pairs with a ghost are worked out by both processes
+    energy += 0.5*shared;
+    MPI_Allreduce(&energy, &potential_energy, 1, MPI_DOUBLE, MPI_SUM, comm);
+    if(Profiler::Enabled() && N > 0){
+        Profiler::Add(Profiler::Evaluations, 1);
+        Profiler::Add(Profiler::Pairs, long(neighbors.End(N-1))
+                      + long(remote.End(N-1)));
+    }
+    return;
+}
+
+void DomainGlass::UpdateKinetic(){
+    /* The kinetic energy of the whole system. */
+    Particles::UpdateKinetic();
+    if(split){
+        double mine = kinetic_energy;
+        MPI_Allreduce(&mine, &kinetic_energy, 1, MPI_DOUBLE, MPI_SUM, comm);
+    }
+    return;
+}
+
+void DomainGlass::Thermalize(double Temp){
+    /* Rescales the velocities to the temperature, as Particles::Thermalize,
+    with the kinetic energy of the whole system. */
+    if(!split){Particles::Thermalize(Temp); return;}
+    Profiler::Scope scope(Profiler::Thermostat);
+    int i, k;
+    double scale_factor = sqrt(0.5*3*Temp*(total-1)/kinetic_energy);
+    for(k=0;k<3;k++){for(i=0;i<N;i++){v[k][i] *= scale_factor;}}
+    UpdateKinetic();
+    return;
+}
+
+Particles* DomainGlass::Output(){
+    /* Gathers the positions, velocities and forces of every particle onto
+    the writer, in their original order. Every process has to call it;
+    only the writer gets the whole system back. */
+    Profiler::Scope scope(Profiler::Exchange);
+    int i, k, p, id;
+    int count = 10*N;
+    std::vector<double> mine(count);
+    for(i=0;i<N;i++){
+        mine[10*i] = ids[i];
+        for(k=0;k<3;k++){
+            mine[10*i+1+k] = r[k][i];
+            mine[10*i+4+k] = v[k][i];
+            mine[10*i+7+k] = f[k][i];
+        }
+    }
+    std::vector<int> counts(size, 0), offsets(size, 0);
+    MPI_Gather(&count, 1, MPI_INT, counts.data(), 1, MPI_INT, 0, comm);
+    for(p=1;p<size;p++){offsets[p] = offsets[p-1] + counts[p-1];}
+    if(Writer()){gathered.resize(10*total);}
+    MPI_Gatherv(mine.data(), count, MPI_DOUBLE, gathered.data(),
+                counts.data(), offsets.data(), MPI_DOUBLE, 0, comm);
+    if(!Writer()){return this;}
+    for(i=0;i<total;i++){
+        id = int(gathered[10*i]);
+        for(k=0;k<3;k++){
+            snapshot->r[k][id] = gathered[10*i+1+k];
+            snapshot->v[k][id] = gathered[10*i+4+k];
+            snapshot->f[k][id] = gathered[10*i+7+k];
+        }
+    }
+    snapshot->setTime(time);
+    return snapshot.get();
+}
+
+#endif /*GLASSIUS_MPI*/
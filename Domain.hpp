@@ -0,0 +1,116 @@
+/*
+Glassy Dynamics Simulation Module: Domain
+Created by Joe Raso, Sat Oct 17 21:58:11 UTC 2026
+Copyright © 2019 Joe Raso, All rights reserved.
+
+This module contains "DomainGlass", the Kob-Anderson glass split over MPI
+processes by spatial domain decomposition, for boxes too big for one process
+(built with "make mpi", run with "mpirun -np P Glassius-mpi.out ..."). The
+box is cut along z into P slabs of equal width, and each process owns the
+particles in its slab: its particle arrays hold only those, so Number() is
+the local count, and the integrators step them as they would a whole system.
+
+The pairs reaching across a slab boundary are found with "ghosts": copies of
+the particles of the neighboring slabs that lie within the halo (the list
+range plus a margin) of the boundary. The ghosts are picked out again and
+exchanged whenever the neighbor lists are rebuilt, and only their positions
+are sent on the steps in between. Each process takes the forces of the
+pairs between its own particles and its ghosts on its own particles only,
+so every cross-boundary pair is worked out on both sides and half its
+energy goes to each. The energies are summed over the processes.
+
+A particle is not handed over the moment it leaves its slab: Migrate moves
+the ones that have left between steps, just before the lists would go stale
+(or once any particle has moved half the skin along z), so no integrator is
+holding on to particle indices at the time. Until then a particle can be out
+of its slab by up to the skin (the margin), which is checked at every
+rebuild. The slabs therefore have to be at least the cutoff plus three skins
+wide. Errors stop every process with MPI_Abort.
+
+The particles keep the ids they had in the whole system (IDs()), so the
+Brownian noise of each one is the same as in a single process run. The
+energy file and trajectory are written by the first process, the trajectory
+frames being gathered onto it in the original particle order. The force
+loop runs on one thread per process.
+*/
+
+#ifndef Domain_hpp
+#define Domain_hpp
+
+#ifdef GLASSIUS_MPI
+
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <mpi.h>
+#include "Particles.hpp"
+
+class Snapshot: public Particles {
+    /* The whole system gathered onto one process, for writing out */
+    public:
+        Snapshot(double rho, double nside, const int* types):
+            Particles(rho, nside) {species.assign(types, types+N);};
+};
+
+class DomainGlass: public Glass {
+    /* The Kob-Anderson glass mixture split into slabs over MPI processes */
+    public:
+        // Constructor: the whole system is set up on every process (with the
+        // same seed), cut off at rc with a neighbor list of the given skin,
+        // and then split up
+        DomainGlass(double rho, double T, double nside, double rc,
+                    double skin);
+        // Accessors
+        inline int Rank(){return rank;};
+        inline int Processes(){return size;};
+        inline int Total(){return total;};
+        inline int Ghosts(){return ghosts;};
+        // Collective versions of the Particles calculations
+        void UpdateForces();
+        void UpdateKinetic();
+        void Thermalize(double Temp);
+        void Migrate();
+        inline bool Writer(){return rank == 0;};
+        Particles* Output();
+    protected:
+        // Slab owning the point z, and z relative to the bottom of this slab
+        // (in the periodic box, so from -L/2 to L/2)
+        int Owner(double z);
+        double Offset(double z);
+        // True on every process if flag is true on any
+        bool Anywhere(bool flag);
+        // Stops every process with the given error if it came up on any
+        void Check(bool bad, std::string error);
+        // Room for n particles (owned and ghosts), keeping the first keep
+        void Reserve(int n, int keep);
+        // Sends outbox[c] to dest[c], receiving inbox[c] from source[c]
+        void Trade();
+        // Picks out and exchanges the ghosts, and rebuilds the lists
+        void Borders();
+        // Sends the ghosts' new positions
+        void Refresh();
+        MPI_Comm comm;
+        int rank, size, total, ghosts;
+        bool split;
+        double lower, width, halo, margin, moved;
+        // The neighbor list of the pairs with a ghost (neighbors holds the
+        // pairs between owned particles), and the z of each particle at the
+        // last migration (moved is the largest displacement since the last
+        // build, at the last call to Migrate)
+        NeighborList remote;
+        std::vector<double> home;
+        // The channels to the neighboring slabs (one with two processes,
+        // none with one), the particles sent down each as ghosts, and the
+        // ghosts received from each
+        std::vector<int> dest, source, received;
+        std::vector<std::vector<int> > sends;
+        std::vector<std::vector<double> > outbox, inbox;
+        std::vector<double> gathered;
+        std::unique_ptr<Snapshot> snapshot;
+};
+
+#endif /*GLASSIUS_MPI*/
+
+#endif /*Domain_hpp*/
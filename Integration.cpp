@@ -6,43 +6,192 @@ Copyright © 2019 Joe Raso, All rights reserved.
 
 #include "Integration.hpp"
 
+void Integrator::SetDirectory(string dir){
+    /* Puts the energy, trajectory, correlator and pair distribution files in
+    the given directory (with a trailing "/"), under their default names. */
+    efilename = dir + "Energies.csv";
+    cfilename = dir + "Correlators.csv";
+    gfilename = dir + "PairDistribution.csv";
+    trajectory.SetDirectory(dir);
+    return;
+}
+
+void Integrator::SetTrajectory(string format, string fields, int buffers){
+    /* Sets the format ("f64", "f32" or "csv") and the fields (some of "rvf")
+    of the recorded trajectory, and the number of frames that can be waiting
+    on the writer thread (0 to write without one). */
+    trajectory.SetFormat(format);
+    trajectory.SetFields(fields);
+    trajectory.SetBuffers(buffers);
+    return;
+}
+
+void Integrator::SetCorrelators(int stride, int points){
+    /* Sets up the on-the-fly correlators to sample every stride steps of a
+    Run, keeping the given number of samples per level (see Correlator.hpp).
+    They only sample once switched on with RecordCorrelators. */
+    correlator.Setup(stride, points);
+    return;
+}
+
+void Integrator::SaveState(Checkpoint& out){
+    /* Puts the integration parameters and time into the checkpoint, along
+    with the correlators. */
+    out.Put(Temp);
+    out.Put(dt);
+    out.Put(time);
+    out.Put(Nrecord);
+    correlator.Save(out);
+    return;
+}
+
+void Integrator::LoadState(Checkpoint& in){
+    in.Get(Temp);
+    in.Get(dt);
+    in.Get(time);
+    in.Get(Nrecord);
+    correlator.Load(in);
+    return;
+}
+
+void Integrator::SaveCheckpoint(int cycle, long counter){
+    /* Checkpoints the run at the end of a cycle: the random number generator,
+    the lengths of the output files (anything written after this will be
+    cut off on resuming), the integrator and the particle system. The energy
+    file has to be flushed beforehand. */
+    Profiler::Scope scope(Profiler::Checkpoints);
+    trajectory.Flush();
+    checkpoint->Begin(cycle, counter);
+    chaos::State rng = chaos::save();
+    checkpoint->Put(rng);
+    std::vector<std::string> files;
+    files.push_back(efilename);
+    if (recordtraj) {
+        std::vector<std::string> traj = trajectory.Files();
+        files.insert(files.end(), traj.begin(), traj.end());
+    }
+    int32_t nfiles = int32_t(files.size());
+    checkpoint->Put(nfiles);
+    for(int q=0;q<nfiles;q++){
+        int32_t length = int32_t(files[q].size());
+        int64_t bytes = Checkpoint::Length(files[q]);
+        checkpoint->Put(length);
+        checkpoint->Put(files[q].data(), length);
+        checkpoint->Put(bytes);
+    }
+    SaveState(*checkpoint);
+    System->Save(*checkpoint);
+    checkpoint->Commit();
+    return;
+}
+
+int Integrator::LoadCheckpoint(long& counter){
+    /* Restores the run from the checkpoint, cutting the output files back to
+    where they were. Returns the cycle to carry on from. */
+    chaos::State rng;
+    checkpoint->Get(rng);
+    chaos::restore(rng);
+    int32_t nfiles, length;
+    int64_t bytes;
+    checkpoint->Get(nfiles);
+    for(int q=0;q<nfiles;q++){
+        checkpoint->Get(length);
+        std::string name(length, ' ');
+        checkpoint->Get(&name[0], length);
+        checkpoint->Get(bytes);
+        Checkpoint::Truncate(name, bytes);
+    }
+    LoadState(*checkpoint);
+    System->Load(*checkpoint);
+    System->setTime(time);
+    counter = checkpoint->Counter();
+    return checkpoint->Cycle();
+}
+
+void Integrator::OpenFiles(std::ofstream& energyfile){
+    /* Opens the energy file for appending, and the trajectory if it is
+    being recorded (it stays open between calls). Only the process that
+    writes the output opens them. */
+    Particles* whole = recordtraj ? System->Output() : System;
+    if (!System->Writer()) {return;};
+    energyfile.open(efilename, std::ios::app);
+    
+    // File check-stop
+    if(!energyfile.is_open()){
+        cout << "Error opening energy file!" << endl;
+        exit(1);
+    }
+    if (recordtraj) {trajectory.Open(whole, dt);};
+    return;
+}
+
+void Integrator::Record(std::ofstream& energyfile){
+    /* Writes the energies at the end of a cycle, and the trajectory frame if
+    it is being recorded. Every process takes part in working them out. */
+    double ke, pe;
+    {
+        Profiler::Scope write(Profiler::Energies);
+        ke = System->KE();
+        pe = System->PE();
+        if (System->Writer()) {
+            energyfile << time << ", ";
+            energyfile << ke << ", ";
+            energyfile << pe << ", ";
+            energyfile << System->TotalEnergy() << std::endl;
+        }
+    }
+    if (recordtraj) {
+        Particles* whole = System->Output();
+        if (System->Writer()) {trajectory.Write(whole, time);};
+    }
+    return;
+}
+
 void Integrator::Equilibrate(double t, int Nthermalize){
     /* Advanced the integration for time=t, themostating the system every
     Nthermalize steps. Records into an energy file as it does. */
+    Profiler::Scope scope(Profiler::Equilibrate);
     
     // Cycling indeces
     int m, n; int steps = int(t/dt);
     int cycles = int(steps/Nrecord);
-    int s = 0; // thermostat counter
+    long s = 0; // thermostat counter
+    int m0 = 0; // first cycle
+    
+    // Skipping the stage, or carrying it on from a checkpoint
+    if (checkpoint) {
+        checkpoint->NextStage();
+        if (checkpoint->Skipping()) {return;};
+        if (checkpoint->Restoring()) {m0 = LoadCheckpoint(s);};
+    }
     
     // Retrieving the system time
     time = System->Time();
     
     // Prepping output file
     std::ofstream energyfile;
-    energyfile.open(efilename, std::ios::app);
-    
-    // File check-stop
-    if(!energyfile.is_open()){
-        cout << "Error opening energy file!" << endl;
-        exit(1);
-    }
+    OpenFiles(energyfile);
     
     // Integrating
-    for(m=0;m<cycles;m++){
+    for(m=m0;m<cycles;m++){
         for(n=0;n<Nrecord;n++){
+            measure = (n==Nrecord-1);
+            System->Migrate();
+            if (System->Reorder()) {Permute(System->Permutation());};
             Propigate(); s++;
             if(s%Nthermalize==0){System->Thermalize(Temp);}
         }
-        energyfile << time << ", ";
-        energyfile << System->KE() << ", ";
-        energyfile << System->PE() << ", ";
-        energyfile << System->TotalEnergy() << std::endl;
-        if (recordtraj) {System->SaveTrajectory();};
+        Record(energyfile);
+        if (checkpoint && checkpoint->Due(m)) {
+            energyfile.flush();
+            SaveCheckpoint(m+1, s);
+        }
     }
     
-    // Closing the energy file
+    // Closing the energy file (steps taken from outside are all measured)
+    measure = true;
     energyfile.close();
+    trajectory.Flush();
     
     // Storing the system time
     System->setTime(time);
@@ -52,37 +201,60 @@ void Integrator::Equilibrate(double t, int Nthermalize){
 
 void Integrator::Run(double t){
     /* Advanced the integration for time=t. Records into an energy file AND a 
-    trajectory file as it does. Does not themostate the system. */
+    trajectory file as it does. Does not themostate the system. When recording
+    pairs, the force evaluations of the recording steps are binned into the
+    pair distance histograms of the system. */
+    Profiler::Scope scope(Profiler::Run);
     
     // Cycling indeces
     int m, n; int steps = int(t/dt);
     int cycles = int(steps/Nrecord);
+    long s = 0; // no thermostat in Run, saved as 0
+    int m0 = 0; // first cycle
+    
+    // Skipping the stage, or carrying it on from a checkpoint
+    if (checkpoint) {
+        checkpoint->NextStage();
+        if (checkpoint->Skipping()) {return;};
+        if (checkpoint->Restoring()) {m0 = LoadCheckpoint(s);};
+    }
     
     // Retrieving the system time
     time = System->Time();
     
     // Prepping output file
     std::ofstream energyfile;
-    energyfile.open(efilename, std::ios::app);
-    
-    // File check-stop
-    if(!energyfile.is_open()){
-        cout << "Error opening energy file!" << endl;
-        exit(1);
-    }
+    OpenFiles(energyfile);
     
     // Integrating
-    for(m=0;m<cycles;m++){
-        for(n=0;n<Nrecord;n++){Propigate();}
-        energyfile << time << ", ";
-        energyfile << System->KE() << ", ";
-        energyfile << System->PE() << ", ";
-        energyfile << System->TotalEnergy() << std::endl;
-        if (recordtraj) {System->SaveTrajectory();};
+    for(m=m0;m<cycles;m++){
+        for(n=0;n<Nrecord;n++){
+            if (recordcorr) {correlator.Step(System->r, System->v,
+                System->Number(), System->Length(), System->IDs());};
+            if (recordgr) {System->BinPairs(n==Nrecord-1);};
+            measure = (n==Nrecord-1);
+            System->Migrate();
+            if (System->Reorder()) {Permute(System->Permutation());};
+            Propigate();
+        }
+        Record(energyfile);
+        if (checkpoint && checkpoint->Due(m)) {
+            energyfile.flush();
+            SaveCheckpoint(m+1, s);
+        }
     }
     
-    // Closing the energy file
+    // Closing the energy file (steps taken from outside are all measured)
+    measure = true;
     energyfile.close();
+    trajectory.Flush();
+    
+    // The correlations so far, over all the runs recorded
+    if (recordcorr && correlator.Active()) {correlator.Save(cfilename, dt);};
+    if (recordgr) {
+        System->BinPairs(false);
+        System->SavePairDistribution(gfilename);
+    }
     
     // Storing the system time
     System->setTime(time);
@@ -94,19 +266,137 @@ void Verlet::Initialize(){return;};
 
 void Verlet::Propigate(){
     /* Advances the velocity Verlet calculation one step.*/
+    Profiler::Scope scope(Profiler::Propigate);
+    Profiler::Count(Profiler::Steps, 1);
     int i,k;
     double dt2 = dt*dt;
     int n = System->Number();
-    for(i=0;i<n;i++){
-        for(k=0;k<3;k++){
-            System->r[i][k] += System->v[i][k]*dt + 0.5*System->f[i][k]*dt2;
-            System->v[i][k] += 0.5*System->f[i][k]*dt;
+    double *r, *v, *f;
+    for(k=0;k<3;k++){
+        r = System->r[k]; v = System->v[k]; f = System->f[k];
+        for(i=0;i<n;i++){
+            r[i] += v[i]*dt + 0.5*f[i]*dt2;
+            v[i] += 0.5*f[i]*dt;
         }
     }
     System->UpdateForces();
-    for(i=0;i<n;i++){
+    for(k=0;k<3;k++){
+        v = System->v[k]; f = System->f[k];
+        for(i=0;i<n;i++){
+            v[i] += 0.5*dt*f[i];
+        }
+    }
+    System->UpdateKinetic();
+    time += dt;
+    return;
+}
+
+/* Multiple Time Step Verlet ------------------------------------------------ */
+
+void RESPA::Initialize(){
+    // The inner and outer forces (same (3 x N) layout as the particle
+    // arrays), worked out at the first step
+    int N = System->Number();
+    Fin = Matrix(3, N);
+    Fout = Matrix(3, N);
+    ready = false;
+}
+
+void RESPA::SaveState(Checkpoint& out){
+    /* The split forces are not saved. They are thrown away here and worked
+    out again at the next step, from the lists the particle system throws
+    away too, just as they will be on a resumed run. */
+    Integrator::SaveState(out);
+    ready = false;
+    return;
+}
+
+void RESPA::LoadState(Checkpoint& in){
+    /* The split forces are worked out again from the restored positions (see
+    SaveState). */
+    Integrator::LoadState(in);
+    ready = false;
+    return;
+}
+
+void RESPA::Permute(const int* from){
+    /* Moves the inner and outer forces kept from the last step over with
+    the particles. */
+    int i, k, p, n = System->Number();
+    double* row;
+    std::vector<double> moved(n);
+    Matrix* split[2] = {&Fin, &Fout};
+    if(!ready){return;}
+    for(p=0;p<2;p++){
+        for(k=0;k<3;k++){
+            row = split[p]->Data()[k];
+            for(i=0;i<n;i++){moved[i] = row[from[i]];}
+            std::copy(moved.begin(), moved.end(), row);
+        }
+    }
+    return;
+}
+
+void RESPA::SplitForces(){
+    /* Both parts of the forces at the current positions, leaving their sum
+    in f. */
+    int i, k;
+    int n = System->Number();
+    System->OuterForces();
+    for(k=0;k<3;k++){
+        for(i=0;i<n;i++){Fout.Data()[k][i] = System->f[k][i];}
+    }
+    System->InnerForces();
+    for(k=0;k<3;k++){
+        for(i=0;i<n;i++){
+            Fin.Data()[k][i] = System->f[k][i];
+            System->f[k][i] += Fout.Data()[k][i];
+        }
+    }
+    ready = true;
+    return;
+}
+
+void RESPA::Propigate(){
+    /* Advances one outer step: a half kick from the outer forces, inner
+    velocity Verlet steps with the inner forces, the outer forces at the new
+    positions, and the other half kick. f is left as the total force. */
+    Profiler::Scope scope(Profiler::Propigate);
+    Profiler::Count(Profiler::Steps, 1);
+    int i, k, s;
+    double h = dt/inner;
+    int n = System->Number();
+    double *r, *v, *f, *fin, *fout;
+    if(!ready){SplitForces();}
+    for(k=0;k<3;k++){
+        v = System->v[k]; fout = Fout.Data()[k];
+        for(i=0;i<n;i++){v[i] += 0.5*dt*fout[i];}
+    }
+    for(s=0;s<inner;s++){
+        for(k=0;k<3;k++){
+            r = System->r[k]; v = System->v[k]; fin = Fin.Data()[k];
+            for(i=0;i<n;i++){
+                v[i] += 0.5*h*fin[i];
+                r[i] += h*v[i];
+            }
+        }
+        System->InnerForces();
         for(k=0;k<3;k++){
-            System->v[i][k] += 0.5*dt*System->f[i][k];
+            v = System->v[k]; f = System->f[k]; fin = Fin.Data()[k];
+            for(i=0;i<n;i++){
+                fin[i] = f[i];
+                v[i] += 0.5*h*fin[i];
+            }
+        }
+    }
+    System->OuterForces();
+    for(k=0;k<3;k++){
+        v = System->v[k]; f = System->f[k];
+        fin = Fin.Data()[k]; fout = Fout.Data()[k];
+        for(i=0;i<n;i++){
+            fout[i] = f[i];
+            v[i] += 0.5*dt*fout[i];
+            f[i] += fin[i];
         }
     }
     System->UpdateKinetic();
@@ -117,45 +407,104 @@ void Verlet::Propigate(){
 /* Overdamped Brownian Dynamics --------------------------------------------- */
 
 void Brownian::Initialize(){
-    // Setting stuff up
-    int i,k;
+    // Setting stuff up (zeroed on allocation). Same (3 x N) layout as the
+    // particle arrays.
     prefactor = sqrt(2*dt*Temp);
     int N = System->Number();
-    randomforce = Matrix(N, 3);
-    F0 = Matrix(N, 3);
-    X0 = Matrix(N, 3);
+    randomforce = Matrix(3, N);
+    F0 = Matrix(3, N);
+    X0 = Matrix(3, N);
     eta = randomforce.Data();
     f0 = F0.Data();
     x0 = X0.Data();
-    for(i=0;i<N;i++){
-        for(k=0;k<3;k++){
-            eta[i][k] = 0;
-            f0[i][k] = 0;
-            x0[i][k] = 0;
-        };
-    };
 }
 
 void Brownian::Propigate(){
     /* Advances the velocity huen calculation one step.*/
+    Profiler::Scope scope(Profiler::Propigate);
+    Profiler::Count(Profiler::Steps, 1);
     
     int i,k;
     int n = System->Number();
     double dtinv = 1/dt;
-    for(i=0;i<n;i++){
-        for(k=0;k<3;k++){
-            eta[i][k] = prefactor*chaos::gaussian(0.0, 1.0);
-            f0[i][k] = System->f[i][k];
-            x0[i][k] = System->r[i][k];
-            System->r[i][k] = x0[i][k] + dt*System->f[i][k] + eta[i][k];
+    double *r, *v, *f, *e, *rold, *fold;
+    // a system split over processes can have gained particles since the
+    // last step
+    if(randomforce.Columns() < n){Initialize();}
+    // drawing the noise for this step as one batch, split over the pool;
+    // each particle's noise is keyed by its id
+    uint64_t batch = chaos::batch();
+    int nthreads = Pool::Size();
+    const int* ids = System->IDs();
+    Pool::Parallel([&](int t){
+        chaos::gaussians(eta, ids, (t*n)/nthreads, ((t+1)*n)/nthreads, batch,
+                         prefactor);
+    });
+    for(k=0;k<3;k++){
+        r = System->r[k]; f = System->f[k];
+        e = eta[k]; rold = x0[k]; fold = f0[k];
+        for(i=0;i<n;i++){
+            fold[i] = f[i];
+            rold[i] = r[i];
+            r[i] = rold[i] + dt*f[i] + e[i];
         }
     }
+    // Only the corrected positions go into the pair histograms
+    bool binning = System->BinningPairs();
+    System->BinPairs(false);
     System->UpdateForces();
-    for(i=0;i<n;i++){
-        for(k=0;k<3;k++){
-            System->r[i][k] = x0[i][k] + 0.5*dt*(System->f[i][k] + f0[i][k])
-                                + eta[i][k];
-            System->v[i][k] = dtinv*(System->r[i][k] - x0[i][k]);
+    System->BinPairs(binning);
+    for(k=0;k<3;k++){
+        r = System->r[k]; v = System->v[k]; f = System->f[k];
+        e = eta[k]; rold = x0[k]; fold = f0[k];
+        for(i=0;i<n;i++){
+            r[i] = rold[i] + 0.5*dt*(f[i] + fold[i]) + e[i];
+            v[i] = dtinv*(r[i] - rold[i]);
+        }
+    }
+    System->UpdateForces();
+    System->UpdateKinetic();
+    time += dt;
+    return;
+}
+
+/* Single Evaluation Overdamped Dynamics ------------------------------------ */
+
+void EulerMaruyama::Initialize(){
+    // The noise, in the same (3 x N) layout as the particle arrays
+    randomforce = Matrix(3, System->Number());
+    eta = randomforce.Data();
+}
+
+void EulerMaruyama::Propigate(){
+    /* Advances the overdamped dynamics one Euler-Maruyama step, with the
+    forces left over from the last step: one force evaluation per step, where
+    the Heun scheme of Brownian takes two. The noise is additive, so this is
+    as accurate as Heun in the noise (strong order 1); only the drift is
+    integrated to lower (first) order. The noise is drawn exactly as in
+    Brownian, so both schemes see the same kicks from the same seed. */
+    Profiler::Scope scope(Profiler::Propigate);
+    Profiler::Count(Profiler::Steps, 1);
+    
+    int i,k;
+    int n = System->Number();
+    double prefactor = sqrt(2*dt*Temp);
+    double *r, *v, *f, *e;
+    if(randomforce.Columns() < n){Initialize();}
+    uint64_t batch = chaos::batch();
+    int nthreads = Pool::Size();
+    const int* ids = System->IDs();
+    Pool::Parallel([&](int t){
+        chaos::gaussians(eta, ids, (t*n)/nthreads, ((t+1)*n)/nthreads, batch,
+                         prefactor);
+    });
+    // the velocity is the displacement over the step, as in Brownian
+    double dtinv = 1/dt;
+    for(k=0;k<3;k++){
+        r = System->r[k]; v = System->v[k]; f = System->f[k]; e = eta[k];
+        for(i=0;i<n;i++){
+            v[i] = f[i] + dtinv*e[i];
+            r[i] += dt*v[i];
         }
     }
     System->UpdateForces();
@@ -163,3 +512,54 @@ void Brownian::Propigate(){
     time += dt;
     return;
 }
+
+/* Metropolis Monte Carlo --------------------------------------------------- */
+
+void MonteCarlo::Initialize(){return;};
+
+void MonteCarlo::SaveState(Checkpoint& out){
+    /* Adds the step size and the acceptance counts to the checkpoint. */
+    Integrator::SaveState(out);
+    out.Put(step);
+    out.Put(tried);
+    out.Put(taken);
+    return;
+}
+
+void MonteCarlo::LoadState(Checkpoint& in){
+    Integrator::LoadState(in);
+    in.Get(step);
+    in.Get(tried);
+    in.Get(taken);
+    return;
+}
+
+void MonteCarlo::Propigate(){
+    /* Sweeps through N trial moves. The potential energy is carried along by
+    the changes of the moves kept; the forces and the exact potential energy
+    are worked out again at the end of the sweeps that are measured. The
+    step is kept under a quarter of the box while adapting. */
+    Profiler::Scope scope(Profiler::Propigate);
+    Profiler::Count(Profiler::Steps, 1);
+    
+    int i, k, m, kept = 0;
+    int n = System->Number();
+    double x[3], change, ratio;
+    System->BinParticles();
+    for(m=0;m<n;m++){
+        i = std::min(int(n*chaos::random()), n-1);
+        for(k=0;k<3;k++){x[k] = System->r[k][i] + step*(2*chaos::random()-1);}
+        change = System->EnergyChange(i, x);
+        if(change > 0 && chaos::random() >= exp(-change/Temp)){continue;}
+        System->MoveParticle(i, x, change);
+        kept++;
+    }
+    tried += n; taken += kept;
+    if(adapting){
+        ratio = std::max(0.8, std::min(1.25, double(kept)/(n*target)));
+        step = std::min(step*ratio, 0.25*System->Length());
+    }
+    if(measure){System->UpdateForces();}
+    time += dt;
+    return;
+}
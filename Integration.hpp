@@ -16,7 +16,13 @@ allowing the type of particle system to be switched out.
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <vector>
+#include "Checkpoint.hpp"
+#include "Correlator.hpp"
 #include "Particles.hpp"
+#include "Potentials.hpp"
+#include "Profiler.hpp"
+#include "Trajectory.hpp"
 #include "chaos.hpp"
 
 class Integrator {
@@ -25,7 +31,10 @@ class Integrator {
         // Constructor
         Integrator(Particles* system, double Temp, double dt, int Nrecord):
             System(system), Temp(Temp), dt(dt), Nrecord(Nrecord), time(0),
-            efilename("Data/Energies.csv"), recordtraj(false) {};
+            efilename("Data/Energies.csv"), recordtraj(false),
+            cfilename("Data/Correlators.csv"), recordcorr(false),
+            gfilename("Data/PairDistribution.csv"), recordgr(false),
+            checkpoint(0), measure(true) {};
         // Accessors
         inline double Temperature() {return Temp;};
         inline void SetTemp(double T) {Temp = T;};
@@ -35,14 +44,32 @@ class Integrator {
         inline void Setdt(double t) {dt = t;};
         inline int GetRecord() {return Nrecord;};
         inline void SetRecord(int n) {Nrecord = n;}
+        // Whether the energies of the next steps are wanted (see measure)
+        inline void SetMeasure(bool m) {measure = m;};
         // Switches & Filenames
+        void SetDirectory(string dir);
         inline void SetEnergyFile(string name) {efilename = name;};
         inline void RecordTrajectory(bool rt) {recordtraj = rt;};
+        void SetTrajectory(string format, string fields, int buffers);
+        inline void SetCorrelatorFile(string name) {cfilename = name;};
+        inline void RecordCorrelators(bool rc) {recordcorr = rc;};
+        void SetCorrelators(int stride, int points);
+        inline void SetPairDistributionFile(string name) {gfilename = name;};
+        inline void RecordPairs(bool rg) {recordgr = rg;};
+        // Checkpointing (see Checkpoint.hpp)
+        inline void SetCheckpoint(Checkpoint* c) {checkpoint = c;};
+        virtual void SaveState(Checkpoint& out);
+        virtual void LoadState(Checkpoint& in);
         // Inheritor calculations
         void Equilibrate(double t, int Nthermalize);
         void Run(double t);
         virtual void Initialize(){return;};
         virtual void Propigate(){return;};
+        // Moves the integrator's own per-particle arrays along with the
+        // particles, when the system has reordered them between steps (see
+        // Particles::Reorder): from[i] is the old place of the particle now
+        // at i. Only arrays kept from one step to the next need moving.
+        virtual void Permute(const int*){return;}
     protected:
         Particles* System;
         // Parameters
@@ -51,6 +78,23 @@ class Integrator {
         // File names and Flags
         string efilename;
         bool recordtraj;
+        Trajectory trajectory;
+        string cfilename;
+        bool recordcorr;
+        Correlator correlator;
+        string gfilename;
+        bool recordgr;
+        // Output files of Run and Equilibrate
+        void OpenFiles(std::ofstream& energyfile);
+        void Record(std::ofstream& energyfile);
+        // Checkpointing
+        void SaveCheckpoint(int cycle, long counter);
+        int LoadCheckpoint(long& counter);
+        Checkpoint* checkpoint;
+        // Whether the energies of the coming step will be looked at. Run and
+        // Equilibrate only record the last step of each cycle; integrators
+        // that can skip the potential energy otherwise may do so.
+        bool measure;
 };
 
 class Verlet: public Integrator {
@@ -64,6 +108,78 @@ class Verlet: public Integrator {
     //protected:
 };
 
+template<class Potential>
+class VerletT: public Integrator {
+    /* Velocity Verlet with the potential fixed at compile time (see
+    Potentials.hpp), for example VerletT<GlassPotential>. The step is the
+    same as Verlet's, but the forces are called directly rather than through
+    the virtual UpdateForces, and the potential energy is only summed on the
+    steps that get recorded. */
+    public:
+        typedef typename Potential::System Model;
+        // Constructor
+        VerletT(Model* system, double Temp, double dt, int Nrecord):
+            Integrator(system, Temp, dt, Nrecord), model(system) {};
+        inline void Propigate(){
+            if(measure){Step<true>();} else {Step<false>();}};
+    protected:
+        template<bool Energy> void Step();
+        Model* model;
+};
+
+template<class Potential> template<bool Energy>
+void VerletT<Potential>::Step(){
+    /* Advances the velocity Verlet calculation one step. */
+    Profiler::Scope scope(Profiler::Propigate);
+    Profiler::Count(Profiler::Steps, 1);
+    int i,k;
+    double dt2 = dt*dt;
+    int n = model->Number();
+    double *r, *v, *f;
+    for(k=0;k<3;k++){
+        r = model->r[k]; v = model->v[k]; f = model->f[k];
+        for(i=0;i<n;i++){
+            r[i] += v[i]*dt + 0.5*f[i]*dt2;
+            v[i] += 0.5*f[i]*dt;
+        }
+    }
+    Potential::template Forces<Energy>(model);
+    for(k=0;k<3;k++){
+        v = model->v[k]; f = model->f[k];
+        for(i=0;i<n;i++){
+            v[i] += 0.5*dt*f[i];
+        }
+    }
+    model->UpdateKinetic();
+    time += dt;
+    return;
+}
+
+class RESPA: public Integrator {
+    /* Derived class for the multiple time step (r-RESPA) Verlet integrator.
+    The pair potential is split at a switching shell (see Kernels::Split):
+    the stiff inner part is integrated with k inner steps of dt/k, and the
+    smooth outer part with kicks of dt at either end of them. Propigate
+    advances one outer step, dt. */
+    public:
+        // Constructor
+        RESPA(Particles* system, double Temp, double dt, int inner,
+              double r1, double width, int Nrecord):
+            Integrator(system, Temp, dt, Nrecord), inner(inner) {
+                System->SetSplit(r1, width); Initialize();};
+        void Initialize();
+        void Propigate();
+        void SaveState(Checkpoint& out);
+        void LoadState(Checkpoint& in);
+        void Permute(const int* from);
+        inline int InnerSteps() {return inner;};
+    protected:
+        void SplitForces();
+        int inner;
+        bool ready;
+        Matrix Fin, Fout;
+};
+
 class Brownian: public Integrator {
     /* Derived class for the Overdamped Brownian integrator */
     public:
@@ -81,4 +197,50 @@ class Brownian: public Integrator {
         double** x0;
 };
 
+class EulerMaruyama: public Integrator {
+    /* Derived class for the single evaluation overdamped integrator */
+    public:
+        // Constructor
+        EulerMaruyama(Particles* system, double Temp, double drag,
+                      double dt, int Nrecord):
+            Integrator(system, Temp, dt, Nrecord), drag(drag){Initialize();};
+        void Initialize();
+        void Propigate();
+    protected:
+        double drag;
+        Matrix randomforce;
+        double** eta;
+};
+
+class MonteCarlo: public Integrator {
+    /* Derived class for Metropolis Monte Carlo. Propigate is a sweep of N
+    single particle moves, each of a particle picked at random, displaced by
+    up to step along each axis, and kept with probability min(1, exp(-dU/T)).
+    A move only works out the energy of the moved particle's pairs (see
+    Particles::EnergyChange). A sweep counts as dt of time. While adapting,
+    the step is scaled after every sweep towards the target acceptance rate;
+    it should be held fixed (Adapt(false)) for production runs. */
+    public:
+        // Constructor
+        MonteCarlo(Particles* system, double Temp, double dt, int Nrecord,
+                   double target):
+            Integrator(system, Temp, dt, Nrecord), step(0.1), target(target),
+            adapting(true), tried(0), taken(0) {Initialize();};
+        void Initialize();
+        void Propigate();
+        void SaveState(Checkpoint& out);
+        void LoadState(Checkpoint& in);
+        // Accessors
+        inline double Step() {return step;};
+        inline void SetStep(double s) {step = s;};
+        inline void Adapt(bool a) {adapting = a;};
+        // Fraction of the moves kept since the last reset
+        inline double Acceptance() {return tried>0 ? double(taken)/tried : 0;};
+        inline void ResetAcceptance() {tried = 0; taken = 0;};
+    protected:
+        double step, target;
+        bool adapting;
+        long tried, taken;
+};
+
 #endif /*Integration_hpp*/
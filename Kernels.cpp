@@ -0,0 +1,858 @@
+/*
+Glassy Dynamics Simulation Module: Kernels
+Created by Joe Raso, Sat Oct 17 20:45:56 UTC 2026
+Copyright © 2019 Joe Raso, All rights reserved.
+*/
+
+#include "Kernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define KERNELS_X86
+#include <immintrin.h>
+#endif
+
+/* Scalar kernel ------------------------------------------------------------ */
+
+namespace {
+
+template<bool Energy>
+double ScalarPairs(int i, const int* js, int n, double** r, double** force,
+                   const int* species, const Kernels::Table& p){
+    /* The reference kernel: one pair at a time. Without Energy the potential
+    energy is not summed, and 0 is returned. */
+    int m, j, k, t;
+    int base = species[i]*p.ntypes;
+    double rij[3], r2, s2, s6, fij;
+    double energy = 0;
+    double Linv = 1.0/p.L;
+    for(m=0;m<n;m++){
+        j = js[m];
+        t = base + species[j];
+        r2 = 0;
+        for(k=0;k<3;k++){
+            rij[k] = r[k][i] - r[k][j];
+            // imposing periodic boundary conditions
+            rij[k] -= p.L*fastround(rij[k]*Linv);
+            r2 += rij[k]*rij[k];
+        }
+        if(r2 >= p.rcut2[t]){continue;}
+        // (sigma/r)^6, with sigma set by the species of the pair
+        s2 = p.sigma2[t]/r2;
+        s6 = s2*s2*s2;
+        // Updating the potential energy
+        if(Energy){energy += 4*p.epsilon[t]*s6*(s6-1) - p.eshift[t];}
+        // Updating the forces
+        fij = p.epsilon[t]*s6*(s6-0.5)/r2;
+        for(k=0;k<3;k++){
+            force[k][i] += fij*rij[k];
+            force[k][j] -= fij*rij[k];
+        }
+    }
+    return energy;
+}
+
+}
+
+double Kernels::Scalar(int i, const int* js, int n, double** r,
+                       double** force, const int* species, const Table& p){
+    /* The reference kernel: one pair at a time. */
+    return ScalarPairs<true>(i, js, n, r, force, species, p);
+}
+
+double Kernels::Binned(int i, const int* js, int n, double** r,
+                       double** force, const int* species, const Table& p){
+    /* The scalar kernel, also counting every pair within the histogram range
+    into the bin of its distance, under the index of its species pair. Takes
+    tabulated potentials as well. */
+    int m, j, k, t, b;
+    int base = species[i]*p.ntypes;
+    double rij[3], r2, s2, s6, fij;
+    double energy = 0;
+    double Linv = 1.0/p.L;
+    for(m=0;m<n;m++){
+        j = js[m];
+        t = base + species[j];
+        r2 = 0;
+        for(k=0;k<3;k++){
+            rij[k] = r[k][i] - r[k][j];
+            // imposing periodic boundary conditions
+            rij[k] -= p.L*fastround(rij[k]*Linv);
+            r2 += rij[k]*rij[k];
+        }
+        if(r2 < p.range2){
+            b = std::min(int(sqrt(r2)*p.binscale), p.bins-1);
+            p.histogram[t*p.bins + b] += 1;
+        }
+        if(r2 >= p.rcut2[t]){continue;}
+        if(p.tables){
+            // or a tabulated potential
+            energy += Spline(p, t, r2, fij);
+        } else {
+            // (sigma/r)^6, with sigma set by the species of the pair
+            s2 = p.sigma2[t]/r2;
+            s6 = s2*s2*s2;
+            // Updating the potential energy
+            energy += 4*p.epsilon[t]*s6*(s6-1) - p.eshift[t];
+            fij = p.epsilon[t]*s6*(s6-0.5)/r2;
+        }
+        // Updating the forces
+        for(k=0;k<3;k++){
+            force[k][i] += fij*rij[k];
+            force[k][j] -= fij*rij[k];
+        }
+    }
+    return energy;
+}
+
+/* Split kernel: the parts of the potential for r-RESPA --------------------- */
+
+double Kernels::Split(int i, const int* js, int n, double** r,
+                      double** force, const int* species, const Table& p){
+    /* The scalar kernel for one part of the potential split up for r-RESPA.
+    With the switch S(r) = 1 + x^2 (2x - 3), x = (r - switch1)/width, going
+    smoothly from 1 to 0 across the switching shell, the inner part (part 1)
+    is S(r) U(r) and the outer part (part 2) is (1 - S(r)) U(r). Each part is
+    a potential of its own, so its force includes the -S'(r) U(r) term. U
+    may be tabulated. Given a histogram, every pair handed over is binned as
+    in Binned (the outer part is handed all of them). */
+    int m, j, k, t, b;
+    int base = species[i]*p.ntypes;
+    double rij[3], r2, s2, s6, e, fij, rr, x, s, ds;
+    double energy = 0;
+    double Linv = 1.0/p.L;
+    double outer2 = (p.switch1 + p.width)*(p.switch1 + p.width);
+    double inner2 = p.switch1*p.switch1;
+    for(m=0;m<n;m++){
+        j = js[m];
+        t = base + species[j];
+        r2 = 0;
+        for(k=0;k<3;k++){
+            rij[k] = r[k][i] - r[k][j];
+            // imposing periodic boundary conditions
+            rij[k] -= p.L*fastround(rij[k]*Linv);
+            r2 += rij[k]*rij[k];
+        }
+        if(p.histogram && r2 < p.range2){
+            b = std::min(int(sqrt(r2)*p.binscale), p.bins-1);
+            p.histogram[t*p.bins + b] += 1;
+        }
+        if(r2 >= p.rcut2[t]){continue;}
+        // pairs beyond the shell are all outer, and those short of it inner
+        if(p.part == 1 && r2 >= outer2){continue;}
+        if(p.part == 2 && r2 <= inner2){continue;}
+        if(p.tables){
+            e = Spline(p, t, r2, fij);
+        } else {
+            s2 = p.sigma2[t]/r2;
+            s6 = s2*s2*s2;
+            e = 4*p.epsilon[t]*s6*(s6-1) - p.eshift[t];
+            fij = p.epsilon[t]*s6*(s6-0.5)/r2;
+        }
+        if(r2 > inner2 && r2 < outer2){
+            // the switch and its derivative (f stores the force over 48, the
+            // particle mass)
+            rr = sqrt(r2);
+            x = (rr - p.switch1)/p.width;
+            s = 1 + x*x*(2*x - 3);
+            ds = 6*x*(x - 1)/p.width;
+            if(p.part == 1){
+                fij = s*fij - ds*e/(48*rr);
+                e = s*e;
+            } else {
+                fij = (1 - s)*fij + ds*e/(48*rr);
+                e = (1 - s)*e;
+            }
+        }
+        energy += e;
+        for(k=0;k<3;k++){
+            force[k][i] += fij*rij[k];
+            force[k][j] -= fij*rij[k];
+        }
+    }
+    return energy;
+}
+
+/* Tabulated kernel: any pair potential, from spline tables --------------- */
+
+double Kernels::Tabulated(int i, const int* js, int n, double** r,
+                          double** force, const int* species, const Table& p){
+    /* The scalar kernel with the energy and force of each pair interpolated
+    from the tables (see Spline), whatever the shape of the potential. */
+    int m, j, k, t;
+    int base = species[i]*p.ntypes;
+    double rij[3], r2, fij;
+    double energy = 0;
+    double Linv = 1.0/p.L;
+    for(m=0;m<n;m++){
+        j = js[m];
+        t = base + species[j];
+        r2 = 0;
+        for(k=0;k<3;k++){
+            rij[k] = r[k][i] - r[k][j];
+            // imposing periodic boundary conditions
+            rij[k] -= p.L*fastround(rij[k]*Linv);
+            r2 += rij[k]*rij[k];
+        }
+        if(r2 >= p.rcut2[t]){continue;}
+        energy += Spline(p, t, r2, fij);
+        for(k=0;k<3;k++){
+            force[k][i] += fij*rij[k];
+            force[k][j] -= fij*rij[k];
+        }
+    }
+    return energy;
+}
+
+/* Mixed precision kernel: single precision pair math ----------------------- */
+
+double Kernels::Mixed(int i, const int* js, int n, double** r,
+                      double** force, const int* species, const Table& p){
+    /* The scalar kernel with the pair math in single precision. The
+    separations are taken (and wrapped) in double, where the positions are,
+    and only then rounded: what is lost is relative to the separation, not to
+    the size of the box. The forces and energy are added up in double. */
+    int m, j, k, t;
+    int base = species[i]*p.ntypes;
+    double d;
+    float rij[3], r2, s2, s6, fij;
+    double energy = 0;
+    double Linv = 1.0/p.L;
+    for(m=0;m<n;m++){
+        j = js[m];
+        t = base + species[j];
+        r2 = 0;
+        for(k=0;k<3;k++){
+            d = r[k][i] - r[k][j];
+            // imposing periodic boundary conditions
+            d -= p.L*fastround(d*Linv);
+            rij[k] = float(d);
+            r2 += rij[k]*rij[k];
+        }
+        if(r2 >= p.rcut2f[t]){continue;}
+        s2 = p.sigma2f[t]/r2;
+        s6 = s2*s2*s2;
+        energy += double(4*p.epsilonf[t]*s6*(s6-1) - p.eshiftf[t]);
+        fij = p.epsilonf[t]*s6*(s6-0.5f)/r2;
+        for(k=0;k<3;k++){
+            force[k][i] += double(fij*rij[k]);
+            force[k][j] -= double(fij*rij[k]);
+        }
+    }
+    return energy;
+}
+
+#ifdef KERNELS_X86
+
+/* AVX2 kernel: 4 partners per step ----------------------------------------- */
+
+namespace {
+
+__attribute__((target("avx2,fma")))
+double Sum4(__m256d a){
+    __m128d s = _mm_add_pd(_mm256_castpd256_pd128(a),
+                           _mm256_extractf128_pd(a, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+}
+
+template<bool Energy>
+__attribute__((target("avx2,fma")))
+double AVX2(int i, const int* js, int n, double** r, double** force,
+            const int* species, const Kernels::Table& p){
+    /* Same arithmetic as the scalar kernel, with the partners' positions and
+    pair parameters gathered four at a time. The reaction forces on the js
+    are written back one by one. Without Energy the energy is skipped. */
+    int m, l, j;
+    double *fx = force[0], *fy = force[1], *fz = force[2];
+    double gx[4], gy[4], gz[4];
+    const __m256d L = _mm256_set1_pd(p.L);
+    const __m256d Linv = _mm256_set1_pd(1.0/p.L);
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d half = _mm256_set1_pd(0.5);
+    const __m256d four = _mm256_set1_pd(4.0);
+    const __m256d xi = _mm256_set1_pd(r[0][i]);
+    const __m256d yi = _mm256_set1_pd(r[1][i]);
+    const __m256d zi = _mm256_set1_pd(r[2][i]);
+    const __m128i base = _mm_set1_epi32(species[i]*p.ntypes);
+    __m256d fxi = _mm256_setzero_pd();
+    __m256d fyi = _mm256_setzero_pd();
+    __m256d fzi = _mm256_setzero_pd();
+    __m256d energy = _mm256_setzero_pd();
+    __m256d dx, dy, dz, r2, rinv2, s2, s6, eps, e, fij, inside;
+    __m128i jv, t;
+    for(m=0;m+4<=n;m+=4){
+        jv = _mm_loadu_si128(reinterpret_cast<const __m128i*>(js+m));
+        t = _mm_add_epi32(base, _mm_i32gather_epi32(species, jv, 4));
+        // separations under the minimum image convention
+        dx = _mm256_sub_pd(xi, _mm256_i32gather_pd(r[0], jv, 8));
+        dy = _mm256_sub_pd(yi, _mm256_i32gather_pd(r[1], jv, 8));
+        dz = _mm256_sub_pd(zi, _mm256_i32gather_pd(r[2], jv, 8));
+        dx = _mm256_fnmadd_pd(L, _mm256_round_pd(_mm256_mul_pd(dx, Linv),
+                _MM_FROUND_TO_NEAREST_INT|_MM_FROUND_NO_EXC), dx);
+        dy = _mm256_fnmadd_pd(L, _mm256_round_pd(_mm256_mul_pd(dy, Linv),
+                _MM_FROUND_TO_NEAREST_INT|_MM_FROUND_NO_EXC), dy);
+        dz = _mm256_fnmadd_pd(L, _mm256_round_pd(_mm256_mul_pd(dz, Linv),
+                _MM_FROUND_TO_NEAREST_INT|_MM_FROUND_NO_EXC), dz);
+        r2 = _mm256_fmadd_pd(dx, dx,
+                _mm256_fmadd_pd(dy, dy, _mm256_mul_pd(dz, dz)));
+        inside = _mm256_cmp_pd(r2, _mm256_i32gather_pd(p.rcut2, t, 8),
+                               _CMP_LT_OQ);
+        // energy and force, zeroed outside the cutoff
+        rinv2 = _mm256_div_pd(one, r2);
+        s2 = _mm256_mul_pd(_mm256_i32gather_pd(p.sigma2, t, 8), rinv2);
+        s6 = _mm256_mul_pd(s2, _mm256_mul_pd(s2, s2));
+        eps = _mm256_i32gather_pd(p.epsilon, t, 8);
+        if(Energy){
+            e = _mm256_fmsub_pd(_mm256_mul_pd(four, eps),
+                                _mm256_mul_pd(s6, _mm256_sub_pd(s6, one)),
+                                _mm256_i32gather_pd(p.eshift, t, 8));
+            energy = _mm256_add_pd(energy, _mm256_and_pd(e, inside));
+        }
+        fij = _mm256_mul_pd(_mm256_mul_pd(eps, rinv2),
+                            _mm256_mul_pd(s6, _mm256_sub_pd(s6, half)));
+        fij = _mm256_and_pd(fij, inside);
+        dx = _mm256_mul_pd(fij, dx);
+        dy = _mm256_mul_pd(fij, dy);
+        dz = _mm256_mul_pd(fij, dz);
+        fxi = _mm256_add_pd(fxi, dx);
+        fyi = _mm256_add_pd(fyi, dy);
+        fzi = _mm256_add_pd(fzi, dz);
+        _mm256_storeu_pd(gx, dx);
+        _mm256_storeu_pd(gy, dy);
+        _mm256_storeu_pd(gz, dz);
+        for(l=0;l<4;l++){
+            j = js[m+l];
+            fx[j] -= gx[l]; fy[j] -= gy[l]; fz[j] -= gz[l];
+        }
+    }
+    fx[i] += Sum4(fxi); fy[i] += Sum4(fyi); fz[i] += Sum4(fzi);
+    // the leftovers
+    return Sum4(energy)
+           + ScalarPairs<Energy>(i, js+m, n-m, r, force, species, p);
+}
+
+/* AVX-512 kernel: 8 partners per step -------------------------------------- */
+
+template<bool Energy>
+__attribute__((target("avx512f,avx2,fma")))
+double AVX512(int i, const int* js, int n, double** r, double** force,
+              const int* species, const Kernels::Table& p){
+    /* Same again with eight partners at a time. The js in one list are all
+    different, so the reaction forces can be scattered back directly. */
+    int m;
+    double *fx = force[0], *fy = force[1], *fz = force[2];
+    const int round = _MM_FROUND_TO_NEAREST_INT|_MM_FROUND_NO_EXC;
+    const __m512d L = _mm512_set1_pd(p.L);
+    const __m512d Linv = _mm512_set1_pd(1.0/p.L);
+    const __m512d one = _mm512_set1_pd(1.0);
+    const __m512d half = _mm512_set1_pd(0.5);
+    const __m512d four = _mm512_set1_pd(4.0);
+    const __m512d xi = _mm512_set1_pd(r[0][i]);
+    const __m512d yi = _mm512_set1_pd(r[1][i]);
+    const __m512d zi = _mm512_set1_pd(r[2][i]);
+    const __m256i base = _mm256_set1_epi32(species[i]*p.ntypes);
+    __m512d fxi = _mm512_setzero_pd();
+    __m512d fyi = _mm512_setzero_pd();
+    __m512d fzi = _mm512_setzero_pd();
+    __m512d energy = _mm512_setzero_pd();
+    __m512d dx, dy, dz, r2, rinv2, s2, s6, eps, e, fij;
+    __mmask8 inside;
+    __m256i jv, t;
+    for(m=0;m+8<=n;m+=8){
+        jv = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(js+m));
+        t = _mm256_add_epi32(base, _mm256_i32gather_epi32(species, jv, 4));
+        // separations under the minimum image convention
+        dx = _mm512_sub_pd(xi, _mm512_i32gather_pd(jv, r[0], 8));
+        dy = _mm512_sub_pd(yi, _mm512_i32gather_pd(jv, r[1], 8));
+        dz = _mm512_sub_pd(zi, _mm512_i32gather_pd(jv, r[2], 8));
+        dx = _mm512_fnmadd_pd(L,
+                _mm512_roundscale_pd(_mm512_mul_pd(dx, Linv), round), dx);
+        dy = _mm512_fnmadd_pd(L,
+                _mm512_roundscale_pd(_mm512_mul_pd(dy, Linv), round), dy);
+        dz = _mm512_fnmadd_pd(L,
+                _mm512_roundscale_pd(_mm512_mul_pd(dz, Linv), round), dz);
+        r2 = _mm512_fmadd_pd(dx, dx,
+                _mm512_fmadd_pd(dy, dy, _mm512_mul_pd(dz, dz)));
+        inside = _mm512_cmp_pd_mask(r2, _mm512_i32gather_pd(t, p.rcut2, 8),
+                                    _CMP_LT_OQ);
+        // energy and force, zeroed outside the cutoff
+        rinv2 = _mm512_div_pd(one, r2);
+        s2 = _mm512_mul_pd(_mm512_i32gather_pd(t, p.sigma2, 8), rinv2);
+        s6 = _mm512_mul_pd(s2, _mm512_mul_pd(s2, s2));
+        eps = _mm512_i32gather_pd(t, p.epsilon, 8);
+        if(Energy){
+            e = _mm512_fmsub_pd(_mm512_mul_pd(four, eps),
+                                _mm512_mul_pd(s6, _mm512_sub_pd(s6, one)),
+                                _mm512_i32gather_pd(t, p.eshift, 8));
+            energy = _mm512_mask_add_pd(energy, inside, energy, e);
+        }
+        fij = _mm512_maskz_mul_pd(inside, _mm512_mul_pd(eps, rinv2),
+                                  _mm512_mul_pd(s6, _mm512_sub_pd(s6, half)));
+        dx = _mm512_mul_pd(fij, dx);
+        dy = _mm512_mul_pd(fij, dy);
+        dz = _mm512_mul_pd(fij, dz);
+        fxi = _mm512_add_pd(fxi, dx);
+        fyi = _mm512_add_pd(fyi, dy);
+        fzi = _mm512_add_pd(fzi, dz);
+        _mm512_i32scatter_pd(fx, jv,
+            _mm512_sub_pd(_mm512_i32gather_pd(jv, fx, 8), dx), 8);
+        _mm512_i32scatter_pd(fy, jv,
+            _mm512_sub_pd(_mm512_i32gather_pd(jv, fy, 8), dy), 8);
+        _mm512_i32scatter_pd(fz, jv,
+            _mm512_sub_pd(_mm512_i32gather_pd(jv, fz, 8), dz), 8);
+    }
+    fx[i] += _mm512_reduce_add_pd(fxi);
+    fy[i] += _mm512_reduce_add_pd(fyi);
+    fz[i] += _mm512_reduce_add_pd(fzi);
+    // the leftovers
+    return _mm512_reduce_add_pd(energy)
+           + ScalarPairs<Energy>(i, js+m, n-m, r, force, species, p);
+}
+
+__attribute__((target("avx512f,avx2,fma")))
+double SplitAVX512(int i, const int* js, int n, double** r, double** force,
+                   const int* species, const Kernels::Table& p){
+    /* The Split kernel eight partners at a time, as the AVX-512 kernel. The
+    switch is worked out for every pair, with x clamped to [0, 1] so that S
+    is 1 short of the shell and 0 beyond it. */
+    int m;
+    double *fx = force[0], *fy = force[1], *fz = force[2];
+    const int round = _MM_FROUND_TO_NEAREST_INT|_MM_FROUND_NO_EXC;
+    const __m512d L = _mm512_set1_pd(p.L);
+    const __m512d Linv = _mm512_set1_pd(1.0/p.L);
+    const __m512d zero = _mm512_setzero_pd();
+    const __m512d one = _mm512_set1_pd(1.0);
+    const __m512d half = _mm512_set1_pd(0.5);
+    const __m512d two = _mm512_set1_pd(2.0);
+    const __m512d three = _mm512_set1_pd(3.0);
+    const __m512d four = _mm512_set1_pd(4.0);
+    const __m512d r1 = _mm512_set1_pd(p.switch1);
+    const __m512d winv = _mm512_set1_pd(1.0/p.width);
+    const __m512d dscale = _mm512_set1_pd(6.0/(48*p.width));
+    const __m512d xi = _mm512_set1_pd(r[0][i]);
+    const __m512d yi = _mm512_set1_pd(r[1][i]);
+    const __m512d zi = _mm512_set1_pd(r[2][i]);
+    const __m256i base = _mm256_set1_epi32(species[i]*p.ntypes);
+    bool outer = (p.part == 2);
+    __m512d fxi = _mm512_setzero_pd();
+    __m512d fyi = _mm512_setzero_pd();
+    __m512d fzi = _mm512_setzero_pd();
+    __m512d energy = _mm512_setzero_pd();
+    __m512d dx, dy, dz, r2, rinv2, rinv, s2, s6, eps, e, fij, fin, x, s, ds;
+    __mmask8 inside;
+    __m256i jv, t;
+    for(m=0;m+8<=n;m+=8){
+        jv = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(js+m));
+        t = _mm256_add_epi32(base, _mm256_i32gather_epi32(species, jv, 4));
+        // separations under the minimum image convention
+        dx = _mm512_sub_pd(xi, _mm512_i32gather_pd(jv, r[0], 8));
+        dy = _mm512_sub_pd(yi, _mm512_i32gather_pd(jv, r[1], 8));
+        dz = _mm512_sub_pd(zi, _mm512_i32gather_pd(jv, r[2], 8));
+        dx = _mm512_fnmadd_pd(L,
+                _mm512_roundscale_pd(_mm512_mul_pd(dx, Linv), round), dx);
+        dy = _mm512_fnmadd_pd(L,
+                _mm512_roundscale_pd(_mm512_mul_pd(dy, Linv), round), dy);
+        dz = _mm512_fnmadd_pd(L,
+                _mm512_roundscale_pd(_mm512_mul_pd(dz, Linv), round), dz);
+        r2 = _mm512_fmadd_pd(dx, dx,
+                _mm512_fmadd_pd(dy, dy, _mm512_mul_pd(dz, dz)));
+        inside = _mm512_cmp_pd_mask(r2, _mm512_i32gather_pd(t, p.rcut2, 8),
+                                    _CMP_LT_OQ);
+        // the whole energy and force
+        rinv2 = _mm512_div_pd(one, r2);
+        s2 = _mm512_mul_pd(_mm512_i32gather_pd(t, p.sigma2, 8), rinv2);
+        s6 = _mm512_mul_pd(s2, _mm512_mul_pd(s2, s2));
+        eps = _mm512_i32gather_pd(t, p.epsilon, 8);
+        e = _mm512_fmsub_pd(_mm512_mul_pd(four, eps),
+                            _mm512_mul_pd(s6, _mm512_sub_pd(s6, one)),
+                            _mm512_i32gather_pd(t, p.eshift, 8));
+        fij = _mm512_mul_pd(_mm512_mul_pd(eps, rinv2),
+                            _mm512_mul_pd(s6, _mm512_sub_pd(s6, half)));
+        // the switch, and the inner part
+        rinv = _mm512_sqrt_pd(rinv2);
+        x = _mm512_mul_pd(_mm512_fmsub_pd(r2, rinv, r1), winv);
+        x = _mm512_min_pd(_mm512_max_pd(x, zero), one);
+        s = _mm512_fmadd_pd(_mm512_mul_pd(x, x),
+                            _mm512_fmsub_pd(two, x, three), one);
+        ds = _mm512_mul_pd(_mm512_mul_pd(dscale, x), _mm512_sub_pd(x, one));
+        fin = _mm512_fnmadd_pd(_mm512_mul_pd(ds, e), rinv,
+                               _mm512_mul_pd(s, fij));
+        // (or the whole less the inner part)
+        if(outer){
+            e = _mm512_fnmadd_pd(s, e, e);
+            fij = _mm512_sub_pd(fij, fin);
+        } else {
+            e = _mm512_mul_pd(s, e);
+            fij = fin;
+        }
+        energy = _mm512_mask_add_pd(energy, inside, energy, e);
+        fij = _mm512_maskz_mov_pd(inside, fij);
+        dx = _mm512_mul_pd(fij, dx);
+        dy = _mm512_mul_pd(fij, dy);
+        dz = _mm512_mul_pd(fij, dz);
+        fxi = _mm512_add_pd(fxi, dx);
+        fyi = _mm512_add_pd(fyi, dy);
+        fzi = _mm512_add_pd(fzi, dz);
+        _mm512_i32scatter_pd(fx, jv,
+            _mm512_sub_pd(_mm512_i32gather_pd(jv, fx, 8), dx), 8);
+        _mm512_i32scatter_pd(fy, jv,
+            _mm512_sub_pd(_mm512_i32gather_pd(jv, fy, 8), dy), 8);
+        _mm512_i32scatter_pd(fz, jv,
+            _mm512_sub_pd(_mm512_i32gather_pd(jv, fz, 8), dz), 8);
+    }
+    fx[i] += _mm512_reduce_add_pd(fxi);
+    fy[i] += _mm512_reduce_add_pd(fyi);
+    fz[i] += _mm512_reduce_add_pd(fzi);
+    // the leftovers
+    return _mm512_reduce_add_pd(energy)
+           + Kernels::Split(i, js+m, n-m, r, force, species, p);
+}
+
+__attribute__((target("avx512f,avx2,fma")))
+inline __m512 Separation(__m256i jlo, __m256i jhi, const double* x,
+                         __m512d xi, __m512d L, __m512d Linv){
+    /* The separations from sixteen partners, under the minimum image
+    convention in double, rounded to single. */
+    const int round = _MM_FROUND_TO_NEAREST_INT|_MM_FROUND_NO_EXC;
+    __m512d lo = _mm512_sub_pd(xi, _mm512_i32gather_pd(jlo, x, 8));
+    __m512d hi = _mm512_sub_pd(xi, _mm512_i32gather_pd(jhi, x, 8));
+    lo = _mm512_fnmadd_pd(L,
+            _mm512_roundscale_pd(_mm512_mul_pd(lo, Linv), round), lo);
+    hi = _mm512_fnmadd_pd(L,
+            _mm512_roundscale_pd(_mm512_mul_pd(hi, Linv), round), hi);
+    return _mm512_castpd_ps(_mm512_insertf64x4(
+               _mm512_castpd256_pd512(_mm256_castps_pd(_mm512_cvtpd_ps(lo))),
+               _mm256_castps_pd(_mm512_cvtpd_ps(hi)), 1));
+}
+
+__attribute__((target("avx512f,avx2,fma")))
+inline __m512d Upper(__m512 a){
+    /* The upper eight of sixteen singles, in double. */
+    return _mm512_cvtps_pd(_mm256_castpd_ps(
+               _mm512_extractf64x4_pd(_mm512_castps_pd(a), 1)));
+}
+
+__attribute__((target("avx512f,avx2,fma")))
+double MixedAVX512(int i, const int* js, int n, double** r, double** force,
+                   const int* species, const Kernels::Table& p){
+    /* The Mixed kernel sixteen partners at a time: the AVX-512 kernel with
+    the pair math in single precision, which fills twice the lanes. The
+    separations are gathered and wrapped eight at a time in double, and the
+    pair forces are added back in double. */
+    int m;
+    double *fx = force[0], *fy = force[1], *fz = force[2];
+    const __m512d L = _mm512_set1_pd(p.L);
+    const __m512d Linv = _mm512_set1_pd(1.0/p.L);
+    const __m512 one = _mm512_set1_ps(1.0f);
+    const __m512 half = _mm512_set1_ps(0.5f);
+    const __m512 four = _mm512_set1_ps(4.0f);
+    const __m512d xi = _mm512_set1_pd(r[0][i]);
+    const __m512d yi = _mm512_set1_pd(r[1][i]);
+    const __m512d zi = _mm512_set1_pd(r[2][i]);
+    const __m512i base = _mm512_set1_epi32(species[i]*p.ntypes);
+    __m512d fxi = _mm512_setzero_pd();
+    __m512d fyi = _mm512_setzero_pd();
+    __m512d fzi = _mm512_setzero_pd();
+    __m512d energy = _mm512_setzero_pd();
+    __m512d flo, fhi;
+    __m512 dx, dy, dz, r2, rinv2, s2, s6, eps, e, fij;
+    __mmask16 inside;
+    __m512i jv, t;
+    __m256i jlo, jhi;
+    for(m=0;m+16<=n;m+=16){
+        jv = _mm512_loadu_si512(js+m);
+        jlo = _mm512_castsi512_si256(jv);
+        jhi = _mm512_extracti64x4_epi64(jv, 1);
+        t = _mm512_add_epi32(base, _mm512_i32gather_epi32(jv, species, 4));
+        dx = Separation(jlo, jhi, r[0], xi, L, Linv);
+        dy = Separation(jlo, jhi, r[1], yi, L, Linv);
+        dz = Separation(jlo, jhi, r[2], zi, L, Linv);
+        r2 = _mm512_fmadd_ps(dx, dx,
+                _mm512_fmadd_ps(dy, dy, _mm512_mul_ps(dz, dz)));
+        inside = _mm512_cmp_ps_mask(r2, _mm512_i32gather_ps(t, p.rcut2f, 4),
+                                    _CMP_LT_OQ);
+        // energy and force in single, zeroed outside the cutoff
+        rinv2 = _mm512_div_ps(one, r2);
+        s2 = _mm512_mul_ps(_mm512_i32gather_ps(t, p.sigma2f, 4), rinv2);
+        s6 = _mm512_mul_ps(s2, _mm512_mul_ps(s2, s2));
+        eps = _mm512_i32gather_ps(t, p.epsilonf, 4);
+        e = _mm512_fmsub_ps(_mm512_mul_ps(four, eps),
+                            _mm512_mul_ps(s6, _mm512_sub_ps(s6, one)),
+                            _mm512_i32gather_ps(t, p.eshiftf, 4));
+        e = _mm512_maskz_mov_ps(inside, e);
+        energy = _mm512_add_pd(energy,
+                    _mm512_add_pd(_mm512_cvtps_pd(_mm512_castps512_ps256(e)),
+                                  Upper(e)));
+        fij = _mm512_maskz_mul_ps(inside, _mm512_mul_ps(eps, rinv2),
+                                  _mm512_mul_ps(s6, _mm512_sub_ps(s6, half)));
+        // the pair forces, back in double
+        dx = _mm512_mul_ps(fij, dx);
+        dy = _mm512_mul_ps(fij, dy);
+        dz = _mm512_mul_ps(fij, dz);
+        flo = _mm512_cvtps_pd(_mm512_castps512_ps256(dx)); fhi = Upper(dx);
+        fxi = _mm512_add_pd(fxi, _mm512_add_pd(flo, fhi));
+        _mm512_i32scatter_pd(fx, jlo,
+            _mm512_sub_pd(_mm512_i32gather_pd(jlo, fx, 8), flo), 8);
+        _mm512_i32scatter_pd(fx, jhi,
+            _mm512_sub_pd(_mm512_i32gather_pd(jhi, fx, 8), fhi), 8);
+        flo = _mm512_cvtps_pd(_mm512_castps512_ps256(dy)); fhi = Upper(dy);
+        fyi = _mm512_add_pd(fyi, _mm512_add_pd(flo, fhi));
+        _mm512_i32scatter_pd(fy, jlo,
+            _mm512_sub_pd(_mm512_i32gather_pd(jlo, fy, 8), flo), 8);
+        _mm512_i32scatter_pd(fy, jhi,
+            _mm512_sub_pd(_mm512_i32gather_pd(jhi, fy, 8), fhi), 8);
+        flo = _mm512_cvtps_pd(_mm512_castps512_ps256(dz)); fhi = Upper(dz);
+        fzi = _mm512_add_pd(fzi, _mm512_add_pd(flo, fhi));
+        _mm512_i32scatter_pd(fz, jlo,
+            _mm512_sub_pd(_mm512_i32gather_pd(jlo, fz, 8), flo), 8);
+        _mm512_i32scatter_pd(fz, jhi,
+            _mm512_sub_pd(_mm512_i32gather_pd(jhi, fz, 8), fhi), 8);
+    }
+    fx[i] += _mm512_reduce_add_pd(fxi);
+    fy[i] += _mm512_reduce_add_pd(fyi);
+    fz[i] += _mm512_reduce_add_pd(fzi);
+    // the leftovers
+    return _mm512_reduce_add_pd(energy)
+           + Kernels::Mixed(i, js+m, n-m, r, force, species, p);
+}
+
+__attribute__((target("avx512f,avx2,fma")))
+double TabulatedAVX512(int i, const int* js, int n, double** r,
+                       double** force, const int* species,
+                       const Kernels::Table& p){
+    /* The Tabulated kernel eight partners at a time, as the AVX-512 kernel:
+    the bin of each pair is worked out in the vector lanes, and its eight
+    spline coefficients gathered from the tables. */
+    int m, k;
+    double *fx = force[0], *fy = force[1], *fz = force[2];
+    const int round = _MM_FROUND_TO_NEAREST_INT|_MM_FROUND_NO_EXC;
+    const __m512d L = _mm512_set1_pd(p.L);
+    const __m512d Linv = _mm512_set1_pd(1.0/p.L);
+    const __m512d xi = _mm512_set1_pd(r[0][i]);
+    const __m512d yi = _mm512_set1_pd(r[1][i]);
+    const __m512d zi = _mm512_set1_pd(r[2][i]);
+    const __m256i base = _mm256_set1_epi32(species[i]*p.ntypes);
+    const __m256i bins = _mm256_set1_epi32(p.tablebins);
+    const __m256i last = _mm256_set1_epi32(p.tablebins - 1);
+    const __m256i zero = _mm256_setzero_si256();
+    __m512d fxi = _mm512_setzero_pd();
+    __m512d fyi = _mm512_setzero_pd();
+    __m512d fzi = _mm512_setzero_pd();
+    __m512d energy = _mm512_setzero_pd();
+    __m512d dx, dy, dz, r2, x, u, e, fij, c[8];
+    __mmask8 inside;
+    __m256i jv, t, bin, index;
+    for(m=0;m+8<=n;m+=8){
+        jv = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(js+m));
+        t = _mm256_add_epi32(base, _mm256_i32gather_epi32(species, jv, 4));
+        // separations under the minimum image convention
+        dx = _mm512_sub_pd(xi, _mm512_i32gather_pd(jv, r[0], 8));
+        dy = _mm512_sub_pd(yi, _mm512_i32gather_pd(jv, r[1], 8));
+        dz = _mm512_sub_pd(zi, _mm512_i32gather_pd(jv, r[2], 8));
+        dx = _mm512_fnmadd_pd(L,
+                _mm512_roundscale_pd(_mm512_mul_pd(dx, Linv), round), dx);
+        dy = _mm512_fnmadd_pd(L,
+                _mm512_roundscale_pd(_mm512_mul_pd(dy, Linv), round), dy);
+        dz = _mm512_fnmadd_pd(L,
+                _mm512_roundscale_pd(_mm512_mul_pd(dz, Linv), round), dz);
+        r2 = _mm512_fmadd_pd(dx, dx,
+                _mm512_fmadd_pd(dy, dy, _mm512_mul_pd(dz, dz)));
+        inside = _mm512_cmp_pd_mask(r2, _mm512_i32gather_pd(t, p.rcut2, 8),
+                                    _CMP_LT_OQ);
+        // the bin and the place within it, as in Spline
+        x = _mm512_mul_pd(_mm512_sub_pd(r2,
+                              _mm512_i32gather_pd(t, p.tablemin, 8)),
+                          _mm512_i32gather_pd(t, p.tablescale, 8));
+        bin = _mm512_cvttpd_epi32(x);
+        bin = _mm256_min_epi32(_mm256_max_epi32(bin, zero), last);
+        u = _mm512_sub_pd(x, _mm512_cvtepi32_pd(bin));
+        index = _mm256_slli_epi32(
+                    _mm256_add_epi32(_mm256_mullo_epi32(t, bins), bin), 3);
+        for(k=0;k<8;k++){
+            c[k] = _mm512_mask_i32gather_pd(_mm512_setzero_pd(), inside,
+                                            index, p.tables + k, 8);
+        }
+        e = _mm512_fmadd_pd(u, _mm512_fmadd_pd(u, _mm512_fmadd_pd(u, c[3],
+                c[2]), c[1]), c[0]);
+        fij = _mm512_fmadd_pd(u, _mm512_fmadd_pd(u, _mm512_fmadd_pd(u, c[7],
+                c[6]), c[5]), c[4]);
+        // (the coefficients are zero outside the cutoff)
+        energy = _mm512_add_pd(energy, e);
+        dx = _mm512_mul_pd(fij, dx);
+        dy = _mm512_mul_pd(fij, dy);
+        dz = _mm512_mul_pd(fij, dz);
+        fxi = _mm512_add_pd(fxi, dx);
+        fyi = _mm512_add_pd(fyi, dy);
+        fzi = _mm512_add_pd(fzi, dz);
+        _mm512_i32scatter_pd(fx, jv,
+            _mm512_sub_pd(_mm512_i32gather_pd(jv, fx, 8), dx), 8);
+        _mm512_i32scatter_pd(fy, jv,
+            _mm512_sub_pd(_mm512_i32gather_pd(jv, fy, 8), dy), 8);
+        _mm512_i32scatter_pd(fz, jv,
+            _mm512_sub_pd(_mm512_i32gather_pd(jv, fz, 8), dz), 8);
+    }
+    fx[i] += _mm512_reduce_add_pd(fxi);
+    fy[i] += _mm512_reduce_add_pd(fyi);
+    fz[i] += _mm512_reduce_add_pd(fzi);
+    // the leftovers
+    return _mm512_reduce_add_pd(energy)
+           + Kernels::Tabulated(i, js+m, n-m, r, force, species, p);
+}
+
+}
+
+#endif /*KERNELS_X86*/
+
+/* Lane kernel: one pair across a batch of replicas ------------------------- */
+
+// Without this the cutoff test counts as a possible trap, and keeps the lane
+// loops from being vectorized
+#pragma GCC push_options
+#pragma GCC optimize("no-trapping-math")
+
+namespace {
+
+template<int W>
+inline __attribute__((always_inline))
+void LaneChunk(int i, const int* js, int n, int K, int lane, double** r,
+               double** force, const int* species, const Kernels::Table& p,
+               double* energy){
+    /* The interactions of particle i with the js, for the W replicas
+    starting at the given lane. Every replica has the same species at the
+    same index, so the pair parameters are shared by the lanes; only the
+    cutoff test differs from lane to lane. */
+    int m, j, l, t;
+    int base = species[i]*p.ntypes;
+    double L = p.L, Linv = 1.0/p.L;
+    const double magic = 6755399441055744.0;
+    double xi[W], yi[W], zi[W], fxi[W], fyi[W], fzi[W], ei[W];
+    const double *x = r[0] + lane, *y = r[1] + lane, *z = r[2] + lane;
+    double *fx = force[0] + lane, *fy = force[1] + lane, *fz = force[2] + lane;
+    for(l=0;l<W;l++){
+        xi[l] = x[i*K+l]; yi[l] = y[i*K+l]; zi[l] = z[i*K+l];
+        fxi[l] = 0; fyi[l] = 0; fzi[l] = 0; ei[l] = 0;
+    }
+    for(m=0;m<n;m++){
+        j = js[m];
+        t = base + species[j];
+        const double eps = p.epsilon[t], sigma2 = p.sigma2[t];
+        const double rcut2 = p.rcut2[t], eshift = p.eshift[t];
+        const double *xj = x + j*K, *yj = y + j*K, *zj = z + j*K;
+        double *fxj = fx + j*K, *fyj = fy + j*K, *fzj = fz + j*K;
+#pragma GCC ivdep
+        for(l=0;l<W;l++){
+            double dx = xi[l] - xj[l];
+            double dy = yi[l] - yj[l];
+            double dz = zi[l] - zj[l];
+            // imposing periodic boundary conditions, rounding by adding and
+            // taking away 1.5*2^52 (branch free, so it vectorizes anywhere)
+            dx -= L*((dx*Linv + magic) - magic);
+            dy -= L*((dy*Linv + magic) - magic);
+            dz -= L*((dz*Linv + magic) - magic);
+            double r2 = dx*dx + dy*dy + dz*dz;
+            double s2 = sigma2/r2;
+            double s6 = s2*s2*s2;
+            double inside = (r2 < rcut2) ? 1.0 : 0.0;
+            double fij = inside*eps*s6*(s6-0.5)/r2;
+            ei[l] += inside*(4*eps*s6*(s6-1) - eshift);
+            fxi[l] += fij*dx; fyi[l] += fij*dy; fzi[l] += fij*dz;
+            fxj[l] -= fij*dx; fyj[l] -= fij*dy; fzj[l] -= fij*dz;
+        }
+    }
+    for(l=0;l<W;l++){
+        fx[i*K+l] += fxi[l]; fy[i*K+l] += fyi[l]; fz[i*K+l] += fzi[l];
+        energy[lane+l] += ei[l];
+    }
+    return;
+}
+
+}
+
+#ifdef KERNELS_X86
+__attribute__((target_clones("avx512f", "avx2", "default")))
+#endif
+void Kernels::Lanes(int i, const int* js, int n, int K, double** r,
+                    double** force, const int* species, const Table& p,
+                    double* energy){
+    /* Works through the replicas eight, then four, then one at a time. */
+    int lane = 0;
+    for(;lane+8<=K;lane+=8){
+        LaneChunk<8>(i, js, n, K, lane, r, force, species, p, energy);
+    }
+    for(;lane+4<=K;lane+=4){
+        LaneChunk<4>(i, js, n, K, lane, r, force, species, p, energy);
+    }
+    for(;lane<K;lane++){
+        LaneChunk<1>(i, js, n, K, lane, r, force, species, p, energy);
+    }
+    return;
+}
+
+#pragma GCC pop_options
+
+/* Dispatch ----------------------------------------------------------------- */
+
+Kernels::Kernel Kernels::Select(std::string name){
+    /* Returns the named kernel if this CPU can run it, the scalar one
+    otherwise. */
+    if(name!="auto" && name!="scalar" && name!="avx2" && name!="avx512"){
+        std::cout << "Error: unknown pair kernel " << name << std::endl;
+        exit(1);
+    }
+#ifdef KERNELS_X86
+    __builtin_cpu_init();
+    bool avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    bool avx512 = avx2 && __builtin_cpu_supports("avx512f");
+    if((name=="auto" || name=="avx512") && avx512){return AVX512<true>;}
+    if((name=="auto" || name=="avx2") && avx2){return AVX2<true>;}
+#endif
+    return Scalar;
+}
+
+Kernels::Kernel Kernels::SplitFor(Kernel kernel){
+    /* Returns the Split kernel to go with a kernel: the AVX-512 one with
+    AVX-512, the scalar one otherwise. */
+#ifdef KERNELS_X86
+    if(kernel==AVX512<true>){return SplitAVX512;}
+#endif
+    return Split;
+}
+
+Kernels::Kernel Kernels::ForcesOnly(Kernel kernel){
+    /* Returns the variant of a kernel from Select that skips the energy. */
+#ifdef KERNELS_X86
+    if(kernel==AVX512<true>){return AVX512<false>;}
+    if(kernel==AVX2<true>){return AVX2<false>;}
+#endif
+    return ScalarPairs<false>;
+}
+
+Kernels::Kernel Kernels::TabulatedFor(Kernel kernel){
+    /* Returns the Tabulated kernel to go with a kernel: the AVX-512 one with
+    AVX-512, the scalar one otherwise. */
+#ifdef KERNELS_X86
+    if(kernel==AVX512<true> || kernel==AVX512<false>){return TabulatedAVX512;}
+#endif
+    return Tabulated;
+}
+
+Kernels::Kernel Kernels::MixedFor(Kernel kernel){
+    /* Returns the Mixed kernel to go with a kernel: the AVX-512 one with
+    AVX-512, the scalar one otherwise. */
+#ifdef KERNELS_X86
+    if(kernel==AVX512<true> || kernel==AVX512<false>){return MixedAVX512;}
+#endif
+    return Mixed;
+}
+
+std::string Kernels::Name(Kernel kernel){
+#ifdef KERNELS_X86
+    if(kernel==AVX512<true>){return "avx512";}
+    if(kernel==AVX2<true>){return "avx2";}
+#endif
+    return "scalar";
+}
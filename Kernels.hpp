@@ -0,0 +1,125 @@
+/*
+Glassy Dynamics Simulation Module: Kernels
+Created by Joe Raso, Sat Oct 17 20:45:56 UTC 2026
+Copyright © 2019 Joe Raso, All rights reserved.
+
+This module contains the pair kernels: the innermost part of the force loop,
+which adds up the Lennard-Jones interactions of one particle i with a list of
+partners j. The Lennard-Jones parameters are looked up per pair of species
+from a table, so one kernel covers every kind of pair. The tabulated kernels
+take any pair potential instead, interpolated from spline tables in r^2 (see
+Tables.hpp) at the same cost whatever its shape.
+
+There is a plain scalar kernel, and vectorized kernels that handle 4 (AVX2) or
+8 (AVX-512) partners at a time. The mixed precision kernels do the pair math
+in single precision (16 partners at a time with AVX-512), but take the
+separations from the double positions, and add up the forces and energy in
+double. Which one is used is decided at run time from
+the features of the CPU; the vector kernels are only compiled on x86.
+
+The lane kernel is for batches of replicas stored side by side: it takes one
+pair at a time, across all of the replicas, so the vector lanes are filled
+with contiguous loads and no gathers. It is compiled for AVX-512, AVX2 and
+plain x86-64, and the loader picks the best clone for the CPU.
+*/
+
+#ifndef Kernels_hpp
+#define Kernels_hpp
+
+#include <string>
+
+// Nearest integer, used for the minimum image convention
+#define fastround(x) (x>=0 ? static_cast<int>(x+0.5) : static_cast<int>(x-0.5))
+
+namespace Kernels {
+    // Pair parameters, each array indexed by a*ntypes+b for species a, b
+    struct Table {
+        int ntypes;
+        double L;
+        const double* epsilon;
+        const double* sigma2;
+        const double* rcut2;
+        const double* eshift;
+        // Pair distance histogram filled by the Binned (or Split) kernel:
+        // bins bins of width 1/binscale per species pair, out to a distance of
+        // sqrt(range2)
+        double* histogram;
+        int bins;
+        double binscale;
+        double range2;
+        // Part of the r-RESPA split potential taken by the Split kernel (1 =
+        // inner, 2 = outer), switching over from switch1 to switch1 + width
+        int part;
+        double switch1;
+        double width;
+        // Cubic spline tables of the pair energy and force in r^2 (see
+        // Tables.hpp), taking the place of the Lennard-Jones parameters when
+        // tables is not 0: tablebins bins per pair, from r^2 = tablemin[t] in
+        // steps of 1/tablescale[t], 8 coefficients each
+        const double* tables;
+        const double* tablemin;
+        const double* tablescale;
+        int tablebins;
+        // Single precision copies of the Lennard-Jones parameters, for the
+        // mixed precision kernels
+        const float* epsilonf;
+        const float* sigma2f;
+        const float* rcut2f;
+        const float* eshiftf;
+    };
+    // The tabulated energy of pair t at r2, setting fij (the force over 48 r,
+    // as in the kernels). Short of the first bin the first cubic is carried on.
+    inline double Spline(const Table& p, int t, double r2, double& fij){
+        double x = (r2 - p.tablemin[t])*p.tablescale[t];
+        int m = int(x);
+        m = (m < 0) ? 0 : ((m >= p.tablebins) ? p.tablebins - 1 : m);
+        double u = x - m;
+        const double* c = p.tables + 8*(t*p.tablebins + m);
+        fij = c[4] + u*(c[5] + u*(c[6] + u*c[7]));
+        return c[0] + u*(c[1] + u*(c[2] + u*c[3]));
+    };
+    // Adds the interactions of particle i with the n particles js[0..n) to
+    // force (both i and the js), given the (3 x N) positions r. Returns the
+    // potential energy of those pairs.
+    typedef double (*Kernel)(int i, const int* js, int n, double** r,
+                             double** force, const int* species,
+                             const Table& table);
+    double Scalar(int, const int*, int, double**, double**, const int*,
+                  const Table&);
+    double Binned(int, const int*, int, double**, double**, const int*,
+                  const Table&);
+    //The scalar kernel, also counting each pair into the histogram.
+    double Split(int, const int*, int, double**, double**, const int*,
+                 const Table&);
+    //The scalar kernel for the inner or outer part of the r-RESPA split
+    //potential.
+    double Tabulated(int, const int*, int, double**, double**, const int*,
+                     const Table&);
+    //The scalar kernel for a tabulated potential.
+    double Mixed(int, const int*, int, double**, double**, const int*,
+                 const Table&);
+    //The scalar kernel in mixed precision: separations taken in double and
+    //rounded to single, pair math in single, sums in double.
+    void Lanes(int, const int*, int, int, double**, double**, const int*,
+               const Table&, double*);
+    //The same interactions for K interleaved replicas at once (see Batch),
+    //given K: particle i of replica l is element i*K+l of each row. Adds the
+    //pair energy of each replica l into energy[l].
+    Kernel Select(std::string);
+    //Picks a kernel by name: "scalar", "avx2", "avx512", or "auto" for the
+    //widest one the CPU supports. Choices the CPU can't run fall back to
+    //scalar; unknown names are an error.
+    Kernel ForcesOnly(Kernel);
+    //The same kernel without the potential energy (it returns 0), for the
+    //steps whose energy is never looked at.
+    Kernel SplitFor(Kernel);
+    //The Split kernel to use alongside a kernel from Select.
+    Kernel TabulatedFor(Kernel);
+    //The Tabulated kernel to use alongside a kernel from Select.
+    Kernel MixedFor(Kernel);
+    //The Mixed kernel to use alongside a kernel from Select.
+    std::string Name(Kernel);
+    //Name of the given kernel.
+};
+
+#endif /*Kernels_hpp*/
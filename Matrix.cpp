@@ -10,13 +10,26 @@
 #include "Matrix.hpp"
 
 
-Matrix::Matrix():data(0),rows(0),columns(0){}
+Matrix::Matrix():data(0),rows(0),columns(0),stride(0){}
 
 Matrix::Matrix(const int& rows,const int& columns):rows(rows),columns(columns){
-    data = new double* [rows];
-    data[0] = new double [rows*columns];
+    Allocate();
+}
+
+void Matrix::Allocate(){
+    //Pads each row to a multiple of 8 doubles, and aligns the whole block
+    stride = ((columns+7)/8)*8;
+    size_t bytes = sizeof(double)*(rows*stride > 0 ? rows*stride : 1);
+    void* block = 0;
+    if(posix_memalign(&block, 64, bytes) != 0){
+        cout << "Error allocating matrix!" << endl;
+        exit(1);
+    }
+    memset(block, 0, bytes);
+    data = new double* [rows > 0 ? rows : 1];
+    data[0] = static_cast<double*>(block);
     for(int i=1;i<rows;i++)
-        data[i]=data[i-1]+columns;//Use pointer math to allocate it
+        data[i]=data[i-1]+stride;//Use pointer math to allocate it
 }
 
 Matrix & Matrix::operator=(const Matrix& rhs){
@@ -25,13 +38,10 @@ Matrix & Matrix::operator=(const Matrix& rhs){
         rows = rhs.rows;
         columns = rhs.columns;
         if(data !=0){
-            delete [] data[0];
+            free(data[0]);
             delete [] data;
         }
-        data = new double* [rows];
-        data[0] = new double [rows*columns];
-        for(i=1;i<rows;i++)
-            data[i]=data[i-1]+columns;
+        Allocate();
         for(i=0;i<rows;i++)
             for(j=0;j<columns;j++)
                 data[i][j] = rhs.data[i][j];
@@ -43,21 +53,25 @@ Matrix::Matrix(const Matrix& rhs){
     int i,j;
     rows = rhs.rows;
     columns = rhs.columns;
-    if(data !=0){
-        data = 0;
-    }
-    data = new double* [rows];
-    data[0] = new double [rows*columns];
-    for(i=1;i<rows;i++)
-        data[i]=data[i-1]+columns;
+    Allocate();
     for(i=0;i<rows;i++)
         for(j=0;j<columns;j++)
             data[i][j] = rhs.data[i][j];
 }
 
+Matrix Matrix::Transpose(){
+    //Returns a (columns x rows) copy, e.g. to turn the (3 x N) particle
+    //arrays back into one row per particle for writing out.
+    Matrix t(columns,rows);
+    for(int i=0;i<rows;i++)
+        for(int j=0;j<columns;j++)
+            t.data[j][i] = data[i][j];
+    return t;
+}
+
 Matrix::~Matrix(){
     if(data !=0){
-        delete [] data[0];
+        free(data[0]);
         delete [] data;
     }
 }
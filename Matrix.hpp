@@ -11,6 +11,8 @@
 #define Matrix_hpp
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <iostream>
 
 using namespace std;
@@ -25,11 +27,16 @@ public:
     inline int Rows(){return rows;};
     inline int Columns(){return columns;};
     double** Data(){return data;};
+    inline int Stride(){return stride;};
+    Matrix Transpose();
     //This is a useful operator to overload
     friend ostream & operator << (ostream& os,const Matrix& rhs);
     ~Matrix();//Destructor
 protected:
-    int rows,columns;
+    //Rows are padded out to whole 64 byte cache lines, and each one starts
+    //on a cache line, so that a row can be streamed with aligned SIMD loads.
+    void Allocate();
+    int rows,columns,stride;
     double** data;
 };
 
@@ -6,8 +6,6 @@ Copyright © 2019 Joe Raso, All rights reserved.
 
 #include "Particles.hpp"
 
-#define fastround(x) (x>=0 ? static_cast<int>(x+0.5) : static_cast<int>(x-0.5))
-
 /* Archetypal Particle Class ------------------------------------------------ */
 
 void Particles::Initialize(){
@@ -27,15 +25,21 @@ void Particles::Initialize(){
     //std::cout << "N is " << N << std::endl;
     //std::cout << "Nside is " << Nside << std::endl;
     
-    // Setting up the trajectory matrices. Note the dimensionality is hard-
-    // coded to 3.
-    positions = Matrix(N,3);
-    velocities = Matrix(N,3);
-    forces = Matrix(N,3);
+    // Setting up the trajectory matrices, one row per component. Note the
+    // dimensionality is hard-coded to 3.
+    positions = Matrix(3,N);
+    velocities = Matrix(3,N);
+    forces = Matrix(3,N);
     r = positions.Data();
     v = velocities.Data();
     f = forces.Data();
     
+    // Every particle starts out as the same species (see Glass::Mixture)
+    species.assign(N, 0);
+    ids.resize(N);
+    for(n=0;n<N;n++){ids[n] = n;}
+    n = 0;
+    
     // Tracking the center-of-mass velocity
     double cmv[3];
     for(k=0;k<3;k++){cmv[k] = 0;}
@@ -46,12 +50,12 @@ void Particles::Initialize(){
        //std::cout << "zcoord=" << lengthscale*(zi+0.5) << std::endl;
        for(yi=0;yi<Nside;yi++){
          for(xi=0;xi<Nside;xi++){
-            r[n][0] = lengthscale*(xi+0.5);
-            r[n][1] = lengthscale*(yi+0.5);
-            r[n][2] = lengthscale*(zi+0.5);
+            r[0][n] = lengthscale*(xi+0.5);
+            r[1][n] = lengthscale*(yi+0.5);
+            r[2][n] = lengthscale*(zi+0.5);
             for(k=0;k<3;k++){
-                v[n][k] = chaos::gaussian(0.0, 1.0);
-                cmv[k] += v[n][k];
+                v[k][n] = chaos::gaussian(0.0, 1.0);
+                cmv[k] += v[k][n];
             }
             n++;
          }
@@ -60,50 +64,24 @@ void Particles::Initialize(){
     
     // Subtracting off the center-of-mass velocity, and calculating KE.
     kinetic_energy = 0;
-    for(n=0;n<N;n++){
-        for(k=0;k<3;k++){
-            v[n][k] -= (cmv[k]/N);
-            kinetic_energy += (24.0)*v[n][k]*v[n][k];
+    for(k=0;k<3;k++){
+        for(n=0;n<N;n++){
+            v[k][n] -= (cmv[k]/N);
+            kinetic_energy += (24.0)*v[k][n]*v[k][n];
         }
     }
     return;
 }
 
-void Particles::SaveTrajectory(){
-    /* Writes positions, velocities and forces to their respective trajectory
-    files. */
-    ofstream rtraj, vtraj, ftraj;
-    
-    rtraj.open("Data/rtraj.csv", std::ios::app);
-    vtraj.open("Data/vtraj.csv", std::ios::app);
-    ftraj.open("Data/ftraj.csv", std::ios::app);
-    
-    // File check-stops
-    if(!rtraj.is_open()){
-        cout << "Error opening position-trajectory file!" << endl;
-        exit(1);
-    }
-    if(!vtraj.is_open()){
-        cout << "Error opening velocity-trajectory file!" << endl;
-        exit(1);
-    }
-    if(!ftraj.is_open()){
-        cout << "Error opening force-trajectory file!" << endl;
-        exit(1);
-    }
-    
-    rtraj << positions; vtraj << velocities; ftraj << forces;
-    rtraj.close(); vtraj.close(); ftraj.close();
-    
-}
-
 void Particles::UpdateKinetic(){
     /* Updates the kinetic energy according to the current particle
     velocities */
     int i, k;
+    double* vk;
     kinetic_energy = 0;
-    for(i=0;i<N;i++){ 
-        for(k=0;k<3;k++){kinetic_energy += (24.0)*(v[i][k]*v[i][k]);}
+    for(k=0;k<3;k++){
+        vk = v[k];
+        for(i=0;i<N;i++){kinetic_energy += (24.0)*(vk[i]*vk[i]);}
     }
     return;
 }
@@ -113,7 +91,9 @@ void Particles::Thermalize(double Temp){
     velocities of all the particles to be in line with the KE based on the
     ideal gas temperature. Not sure if this belongs here or in the integrator
     section.*/
+    Profiler::Scope scope(Profiler::Thermostat);
     int i, k;
+    double* vk;
 
     // figuring out the factor needed to readjust the velocities.
     double KEnew = (0.5)*3*Temp*(N-1);
@@ -123,10 +103,11 @@ void Particles::Thermalize(double Temp){
     kinetic_energy = 0;
     
     // rescaling all the velocities and re-tally kinetic energy
-    for(i=0;i<N;i++){ 
-        for(k=0;k<3;k++){
-            v[i][k] *= scale_factor;
-            kinetic_energy += (24.0)*(v[i][k]*v[i][k]);
+    for(k=0;k<3;k++){
+        vk = v[k];
+        for(i=0;i<N;i++){
+            vk[i] *= scale_factor;
+            kinetic_energy += (24.0)*(vk[i]*vk[i]);
         }
     }
     return;
@@ -137,137 +118,781 @@ void Particles::Thermalize(double Temp){
 void Free::UpdateForces(){
     int i, k;
     // Zero out the forces and potential energy
-    for(i=0;i<N;i++){for(k=0;k<3;k++){f[i][k]=0;};};
+    for(k=0;k<3;k++){for(i=0;i<N;i++){f[k][i]=0;};};
     potential_energy = 0;
     return;
 }
 
-/* The Lennard-Jones Fluid -------------------------------------------------- */
+void Particles::Save(Checkpoint& out){
+    /* Puts the positions, velocities, forces, time and energies into the
+    checkpoint, along with the pair histograms. The neighbor list is not
+    saved: it is thrown away here and rebuilt at the next force evaluation,
+    just as it will be on a resumed run, so both go on with the same list. */
+    int k;
+    out.Put(N);
+    out.Put(time);
+    out.Put(kinetic_energy);
+    out.Put(potential_energy);
+    for(k=0;k<3;k++){out.Put(r[k], sizeof(double)*N);}
+    for(k=0;k<3;k++){out.Put(v[k], sizeof(double)*N);}
+    for(k=0;k<3;k++){out.Put(f[k], sizeof(double)*N);}
+    // the pair histograms binned so far
+    int64_t hsize = int64_t(histogram.size());
+    out.Put(hbins);
+    out.Put(hframes);
+    out.Put(hsize);
+    if(hsize > 0){out.Put(histogram.data(), sizeof(double)*hsize);}
+    // the order the particles are in (see Reorder)
+    out.Put(&ids[0], sizeof(int)*N);
+    out.Put(since);
+    neighbors.Invalidate();
+    inner.Invalidate();
+    return;
+}
 
-void Fluid::UpdateForces(){
-    /* Exicutes the forceloop for the simple Lennard-Jones fluid, updating the
-    forces and potential energy. */
-    int i, j, k;
-    
-    // Zero out the forces and potential energy
-    for(i=0;i<N;i++){for(k=0;k<3;k++){f[i][k]=0;};};
-    potential_energy = 0;
-    
-    // force-loop variables we need
-    double rij[3], r2, r2inv, r6inv, fij;
-    double Linv = 1.0 / sidelength;
+void Particles::Load(Checkpoint& in){
+    /* Restores the state saved by Save. */
+    int k, n;
+    in.Get(n);
+    if(n != N){
+        std::cout << "Error: checkpoint has " << n << " particles, not " << N
+                  << "!" << std::endl;
+        exit(1);
+    }
+    in.Get(time);
+    in.Get(kinetic_energy);
+    in.Get(potential_energy);
+    for(k=0;k<3;k++){in.Get(r[k], sizeof(double)*N);}
+    for(k=0;k<3;k++){in.Get(v[k], sizeof(double)*N);}
+    for(k=0;k<3;k++){in.Get(f[k], sizeof(double)*N);}
+    int bins;
+    int64_t hsize;
+    in.Get(bins);
+    in.Get(hframes);
+    in.Get(hsize);
+    if(bins != hbins){
+        std::cout << "Error: checkpoint has " << bins << " g(r) bins, not "
+                  << hbins << "!" << std::endl;
+        exit(1);
+    }
+    histogram.resize(hsize);
+    if(hsize > 0){in.Get(histogram.data(), sizeof(double)*hsize);}
+    // putting the species back in the saved order
+    std::vector<int> original(N);
+    for(k=0;k<N;k++){original[ids[k]] = species[k];}
+    in.Get(&ids[0], sizeof(int)*N);
+    in.Get(since);
+    for(k=0;k<N;k++){
+        species[k] = original[ids[k]];
+        reordered = reordered || ids[k] != k;
+    }
+    neighbors.Invalidate();
+    inner.Invalidate();
+    return;
+}
+
+namespace {
+
+uint64_t Spread(uint64_t x){
+    /* Spreads the low 21 bits of x out to every third bit, so that three of
+    them can be interleaved into a Morton key. */
+    x &= 0x1fffff;
+    x = (x | x << 32) & 0x1f00000000ffffULL;
+    x = (x | x << 16) & 0x1f0000ff0000ffULL;
+    x = (x | x << 8) & 0x100f00f00f00f00fULL;
+    x = (x | x << 4) & 0x10c30c30c30c30c3ULL;
+    x = (x | x << 2) & 0x1249249249249249ULL;
+    return x;
+}
+
+}
+
+bool Particles::Reorder(){
+    /* Once every reorder calls, sorts the particles by the Morton key of
+    where they are in the box (wrapped back into it, on a 1024^3 grid), so
+    that the particles of a cell, and the partners in a neighbor list, are
+    mostly close together in memory. The positions, velocities, forces,
+    species and ids are all moved; the neighbor lists are thrown away, to be
+    rebuilt in the new order at the next force evaluation. */
+    if(reorder <= 0 || ++since < reorder){return false;}
+    Profiler::Scope scope(Profiler::Reorder);
+    int i, k, q, c;
+    double x, scale = 1024/sidelength;
+    since = 0;
+    std::vector<std::pair<uint64_t, int> > keys(N);
+    for(i=0;i<N;i++){
+        keys[i].first = 0;
+        keys[i].second = i;
+        for(k=0;k<3;k++){
+            x = r[k][i] - sidelength*std::floor(r[k][i]/sidelength);
+            c = std::min(int(x*scale), 1023);
+            keys[i].first |= Spread(c) << k;
+        }
+    }
+    std::sort(keys.begin(), keys.end());
+    permutation.resize(N);
+    for(i=0;i<N;i++){permutation[i] = keys[i].second;}
     
-    // The force loop (dun dun duuuuun)
+    // Moving everything over
+    double** arrays[3] = {r, v, f};
+    std::vector<double> moved(N);
+    for(q=0;q<3;q++){
+        for(k=0;k<3;k++){
+            for(i=0;i<N;i++){moved[i] = arrays[q][k][permutation[i]];}
+            std::copy(moved.begin(), moved.end(), arrays[q][k]);
+        }
+    }
+    std::vector<int> old(species);
+    for(i=0;i<N;i++){species[i] = old[permutation[i]];}
+    old = ids;
+    for(i=0;i<N;i++){ids[i] = old[permutation[i]];}
+    neighbors.Invalidate();
+    inner.Invalidate();
+    reordered = true;
+    return true;
+}
+
+/* Lennard-Jones pair interactions ----------------------------------------- */
+
+void Particles::SetTypes(int n){
+    /* Sizes the pair table for n species. All pairs start out with no
+    interaction until set with SetPair. */
+    ntypes = n;
+    epsilon.assign(n*n, 0);
+    sigma2.assign(n*n, 1);
+    rcut2.assign(n*n, HUGE_VAL);
+    eshift.assign(n*n, 0);
+    rlist2.assign(n*n, HUGE_VAL);
+    return;
+}
+
+void Particles::SetPair(int a, int b, double eps, double sigma){
+    /* Sets the Lennard-Jones energy and length scales for the a-b pair (and
+    the b-a pair, by symmetry). */
+    epsilon[a*ntypes+b] = eps; epsilon[b*ntypes+a] = eps;
+    sigma2[a*ntypes+b] = sigma*sigma; sigma2[b*ntypes+a] = sigma*sigma;
+    return;
+}
+
+void Particles::SetCutoff(double rc){
+    /* Truncates and shifts the pair potentials at rc (in units of the sigma
+    of each pair), and switches the force loop over to the cell list when the
+    box is large enough to hold one. rc = 0 restores the untruncated,
+    all-pairs potential. A tabulated potential is cut at its own range if it
+    has one, and its tables are rebuilt. Recalculates the forces for the new
+    potential. */
+    int t;
+    double rmax = 0;
+    double s6, fij, skin = neighbors.Skin();
+    double reach = (shape == "") ? rc : PairTable::Range(shape, rc);
+    cutoff = rc;
+    for(t=0;t<ntypes*ntypes;t++){
+        if(reach > 0){
+            rcut2[t] = reach*reach*sigma2[t];
+            s6 = 1.0/(reach*reach*reach*reach*reach*reach);
+            eshift[t] = 4*epsilon[t]*s6*(s6-1);
+            if(shape != ""){
+                eshift[t] = PairTable::Shape(shape, epsilon[t], sigma2[t],
+                                             rcut2[t], fij);
+            }
+            rlist2[t] = (sqrt(rcut2[t]) + skin)*(sqrt(rcut2[t]) + skin);
+            rmax = std::max(rmax, sqrt(rlist2[t]));
+        } else {
+            rcut2[t] = HUGE_VAL;
+            eshift[t] = 0;
+            rlist2[t] = HUGE_VAL;
+        }
+    }
+    if(shape != ""){
+        tables.Build(shape, tablebins, ntypes, &epsilon[0], &sigma2[0],
+                     &rcut2[0], &eshift[0]);
+    }
+    // cells have to cover the list range when using a neighbor list
+    cells.Setup(sidelength, rmax);
+    neighbors.Invalidate();
+    inner.Invalidate();
+    UpdateForces();
+    return;
+}
+
+void Particles::SetSkin(double skin){
+    /* Turns on the Verlet neighbor list with the given skin distance (only
+    used along with a cutoff). skin = 0 turns it back off. */
+    neighbors.SetSkin(skin);
+    inner.SetSkin(skin);
+    SetCutoff(cutoff);
+    return;
+}
+
+void Particles::NeighborStats(){
+    /* Prints how often the neighbor list has been rebuilt, and how long the
+    lists are on average. */
+    if(!UsingNeighbors()){return;}
+    std::cout << "Neighbor list rebuilt " << neighbors.Builds() << " times in "
+              << neighbors.Calls() << " force evaluations";
+    if(neighbors.Builds() > 0){
+        std::cout << " (every " << double(neighbors.Calls())/neighbors.Builds()
+                  << ")";
+    }
+    std::cout << std::endl;
+    std::cout << "Average list length = " << neighbors.AverageLength()
+              << " pairs per particle" << std::endl;
+    return;
+}
+
+double Particles::PairsPerEvaluation(){
+    /* About how many pairs a force evaluation hands to the pair kernel: the
+    average list length with a neighbor list, the particles in half of the 27
+    surrounding cells with a cell list, and every pair otherwise. */
+    if(UsingNeighbors() && neighbors.Builds() > 0){
+        return N*neighbors.AverageLength();
+    }
+    if(cells.Active()){
+        double w = cells.Width();
+        return 0.5*N*27*N*(w*w*w)/(sidelength*sidelength*sidelength);
+    }
+    return 0.5*N*(N-1);
+}
+
+void Particles::SetKernel(std::string name){
+    /* Picks the pair kernel used in the force loop (see Kernels). */
+    kernel = Kernels::Select(name);
+    UpdateForces();
+    return;
+}
+
+bool Particles::CheckKernel(double tolerance){
+    /* Compares the forces and energy from the current kernel against the
+    scalar kernel (in double precision) on the current configuration. Returns
+    true if they agree to within the given relative tolerance. */
+    int i, k;
+    Kernels::Kernel chosen = kernel;
+    bool single = mixed;
+    UpdateForces();
+    double e1 = potential_energy;
+    Matrix f1 = forces;
+    kernel = Kernels::Scalar;
+    mixed = false;
+    UpdateForces();
+    double e0 = potential_energy;
+    double fmax = 0, dfmax = 0;
+    for(k=0;k<3;k++){
+        for(i=0;i<N;i++){
+            fmax = std::max(fmax, fabs(f[k][i]));
+            dfmax = std::max(dfmax, fabs(f[k][i] - f1.Data()[k][i]));
+        }
+    }
+    kernel = chosen;
+    mixed = single;
+    UpdateForces();
+    double ferr = (fmax > 0) ? dfmax/fmax : dfmax;
+    double eerr = fabs(e1 - e0)/std::max(fabs(e0), 1.0);
+    std::cout << "Kernel " << Kernels::Name(kernel) << " (" << Precision()
+              << ") vs scalar: "
+              << "force deviation " << ferr << ", energy deviation " << eerr
+              << std::endl;
+    return ferr <= tolerance && eerr <= tolerance;
+}
+
+void Particles::SetPrecision(std::string name){
+    /* Picks double or mixed precision pair math (tabulated potentials and
+    the r-RESPA split are always worked out in double). */
+    if(name != "double" && name != "mixed"){
+        std::cout << "Error: unknown precision " << name << std::endl;
+        exit(1);
+    }
+    mixed = (name == "mixed");
+    UpdateForces();
+    return;
+}
+
+void Particles::SetPotential(std::string name, int bins){
+    /* Switches over to the tabulated potential of the given shape, or back
+    to the analytic one, and recalculates the forces (see SetCutoff). */
+    if(name != "analytic" && !PairTable::Known(name)){
+        std::cout << "Error: unknown pair potential " << name << std::endl;
+        exit(1);
+    }
+    if(name != "analytic" && bins < 1){
+        std::cout << "Error: a tabulated potential needs bins!" << std::endl;
+        exit(1);
+    }
+    shape = (name == "analytic") ? "" : name;
+    tablebins = bins;
+    SetCutoff(cutoff);
+    return;
+}
+
+bool Particles::CheckTables(double tolerance){
+    /* Checks the tables against the exact shape between the knots, and for
+    tabulated Lennard-Jones, the forces and energy against the analytic scalar
+    kernel on the current configuration. Returns true if all agree to within
+    the given relative tolerance. */
+    if(shape == ""){return true;}
+    double eerr, ferr;
+    tables.Deviation(eerr, ferr);
+    std::cout << "Tabulated " << shape << " (" << tablebins << " bins) vs "
+              << "exact: force deviation " << ferr << ", energy deviation "
+              << eerr << std::endl;
+    bool good = ferr <= tolerance && eerr <= tolerance;
+    if(shape != "lj"){return good;}
+    int i, k;
+    UpdateForces();
+    double e1 = potential_energy;
+    Matrix f1 = forces;
+    Kernels::Kernel chosen = kernel;
+    kernel = Kernels::Scalar;
+    shape = "";
+    UpdateForces();
+    double e0 = potential_energy;
+    double fmax = 0, dfmax = 0;
+    for(k=0;k<3;k++){
+        for(i=0;i<N;i++){
+            fmax = std::max(fmax, fabs(f[k][i]));
+            dfmax = std::max(dfmax, fabs(f[k][i] - f1.Data()[k][i]));
+        }
+    }
+    shape = "lj";
+    kernel = chosen;
+    UpdateForces();
+    ferr = (fmax > 0) ? dfmax/fmax : dfmax;
+    eerr = fabs(e1 - e0)/std::max(fabs(e0), 1.0);
+    std::cout << "Tabulated lj vs analytic: force deviation " << ferr
+              << ", energy deviation " << eerr << std::endl;
+    return good && ferr <= tolerance && eerr <= tolerance;
+}
+
+/* Pair distance histograms ------------------------------------------------ */
+
+void Particles::SetHistogram(int bins){
+    /* Sets up (bins > 0) or switches off (bins = 0) the pair distance
+    histograms, clearing anything binned so far. */
+    hbins = bins;
+    hframes = 0;
+    binning = binning && bins > 0;
+    histogram.clear();
+    return;
+}
+
+double Particles::HistogramRange(){
+    /* The distance out to which every pair is seen by the force loop: the
+    shortest pair cutoff (which a tabulated potential of finite range has
+    even without a cutoff), or half the box without one. */
+    double range = 0.5*sidelength;
+    for(int t=0;t<ntypes*ntypes;t++){
+        if(rcut2[t] < HUGE_VAL){range = std::min(range, sqrt(rcut2[t]));}
+    }
+    return range;
+}
+
+void Particles::SavePairDistribution(std::string filename){
+    /* Writes g(r) for every pair of species a <= b (AA, AB, BB for the
+    glass) from the histograms binned so far: one line per bin, the bin
+    center followed by g(r) of each pair. Each g(r) is normalized by the
+    number of a-b pairs an ideal gas would put in the shell. */
+    int a, b, n, t, j;
+    if(hbins == 0 || hframes == 0){return;}
+    std::ofstream file;
+    file.open(filename);
+    // File check-stop
+    if(!file.is_open()){
+        std::cout << "Error opening pair distribution file!" << std::endl;
+        exit(1);
+    }
+    // Adding up the threads, and the a-b and b-a halves
+    int ntab = ntypes*ntypes*hbins;
+    std::vector<double> total(ntab, 0);
+    for(j=0;j<int(histogram.size());j++){total[j%ntab] += histogram[j];}
+    std::vector<double> count(ntypes, 0);
+    for(j=0;j<N;j++){count[species[j]] += 1;}
+    double width = HistogramRange()/hbins;
+    double volume = sidelength*sidelength*sidelength;
+    file.precision(10);
+    for(n=0;n<hbins;n++){
+        double r1 = n*width, r2 = (n+1)*width;
+        double shell = (4.0/3.0)*M_PI*(r2*r2*r2 - r1*r1*r1)/volume;
+        file << (n + 0.5)*width;
+        for(a=0;a<ntypes;a++){
+            for(b=a;b<ntypes;b++){
+                t = a*ntypes + b;
+                double pairs = (a==b) ? 0.5*count[a]*(count[a]-1)
+                                      : count[a]*count[b];
+                double binned = total[t*hbins+n];
+                if(a != b){binned += total[(b*ntypes+a)*hbins+n];}
+                file << ", " << ((pairs > 0) ? binned/(hframes*pairs*shell)
+                                            : 0);
+            }
+        }
+        file << std::endl;
+    }
+    file.close();
+    return;
+}
+
+void Particles::SetSplit(double r1, double w){
+    /* Sets up the switching shell of the r-RESPA split. */
+    switch1 = r1;
+    width = w;
+    inner.SetSkin(neighbors.Skin());
+    return;
+}
+
+void Particles::InnerForces(){
+    /* The forces and energy of the inner (short range) part. */
+    part = 1;
+    UpdateForces();
+    part = 0;
+    return;
+}
+
+void Particles::OuterForces(){
+    /* The forces and energy of the outer (long range) part. */
+    part = 2;
+    UpdateForces();
+    part = 0;
+    return;
+}
+
+void Particles::BuildInner(double Linv){
+    /* Rebuilds the inner neighbor list from the full one: every pair closer
+    than the end of the switching shell plus the skin. Pairs further out
+    than the full list reaches don't interact at all. */
+    Profiler::Scope scope(Profiler::Neighbors);
+    int i, j, k, n;
+    double d, r2;
+    double reach = (switch1 + width + inner.Skin());
+    if(neighbors.Stale(r, N)){BuildNeighbors(Linv);}
+    inner.Begin(r, N);
     for(i=0;i<N;i++){
-        for(j=i+1;j<N;j++){
-            // calculating the radius
+        for(n=neighbors.Start(i);n<neighbors.End(i);n++){
+            j = neighbors.Neighbor(n);
             r2 = 0;
             for(k=0;k<3;k++){
-                rij[k] = r[i][k] - r[j][k];
-                // imposing periodic boundary conditions
-                rij[k] -= sidelength*fastround(rij[k]*Linv);
-                r2 += rij[k]*rij[k];
-            }
-            r2inv = (1.0)/r2;
-            r6inv = r2inv*r2inv*r2inv;
-            // Updating the potential energy
-            potential_energy += 4*r6inv*(r6inv-1);
-            // Updating the forces
-            fij = r6inv*r2inv*(r6inv-0.5);
-            for(k=0;k<3;k++){
-                f[i][k] += fij*rij[k];
-                f[j][k] -= fij*rij[k];
+                d = r[k][i] - r[k][j];
+                d -= sidelength*fastround(d*Linv);
+                r2 += d*d;
             }
+            if(r2 < reach*reach){inner.Add(i, j);}
         }
     }
+    inner.Finish();
     return;
 }
 
-/* The Kob-Anderson Glass --------------------------------------------------- */
+void Particles::BuildNeighbors(double Linv){
+    /* Rebuilds the neighbor list from every pair closer than the cutoff plus
+    the skin, found with the cell list if there is one. */
+    Profiler::Scope scope(Profiler::Neighbors);
+    int i, j, k, c, s, t;
+    double d, r2;
+    neighbors.Begin(r, N);
+    if(cells.Active()){cells.Build(r, N);}
+    // lambda for testing and adding one pair to the list
+    auto near = [&](int a, int b){
+        t = species[a]*ntypes + species[b];
+        r2 = 0;
+        for(k=0;k<3;k++){
+            d = r[k][a] - r[k][b];
+            d -= sidelength*fastround(d*Linv);
+            r2 += d*d;
+        }
+        if(r2 < rlist2[t]){neighbors.Add(a, b);}
+    };
+    if(cells.Active()){
+        for(c=0;c<cells.Count();c++){
+            for(i=cells.Head(c);i>=0;i=cells.Next(i)){
+                for(j=cells.Next(i);j>=0;j=cells.Next(j)){near(i, j);}
+                for(s=0;s<13;s++){
+                    for(j=cells.Head(cells.Neighbor(c,s));j>=0;
+                        j=cells.Next(j)){near(i, j);}
+                }
+            }
+        }
+    } else {
+        for(i=0;i<N;i++){for(j=i+1;j<N;j++){near(i, j);}}
+    }
+    neighbors.Finish();
+    return;
+}
 
-void Glass::UpdateForces(){
-    /* Excicutes the forceloop for the Kob-Anderson glass mixture, updating the
-    forces and potential energy. */
-    int i, j, k;
+template<bool Energy>
+void Particles::PairForces(){
+    /* Exicutes the forceloop for Lennard-Jones particles, updating the forces
+    and, with Energy, the potential energy. Pairs are taken from the neighbor
+    list if it is on, found with the cell list when one is set up, and by
+    checking every i<j pair otherwise; either way, each particle's partners
+    are handed to the pair kernel as one list. The loop is split over the
+    threads of the pool: each thread adds its pairs into its own force buffer
+    and energy (thread 0 uses f itself), and the buffers are summed into f at
+    the end. */
+    Profiler::Scope scope(Profiler::Forces);
+    int nthreads = Pool::Size();
     
-    // Zero out the forces and potential energy
-    for(i=0;i<N;i++){for(k=0;k<3;k++){f[i][k]=0;};};
-    potential_energy = 0;
+    // Shared pair-finding structures are rebuilt up front (the inner part
+    // of a split potential has a shorter list of its own)
+    if(UsingNeighbors() && part == 1){
+        if(inner.Stale(r, N)){BuildInner(1.0/sidelength);}
+    } else if(UsingNeighbors()){
+        if(neighbors.Stale(r, N)){BuildNeighbors(1.0/sidelength);}
+    } else if(cells.Active()){
+        cells.Build(r, N);
+    } else if(int(identity.size()) != N){
+        identity.resize(N);
+        for(int i=0;i<N;i++){identity[i] = i;}
+    }
     
-    // force-loop variables we need
-    double rij[3], r2, r2inv, r6inv, fij;
-    double Linv = 1.0 / sidelength;
+    // Per-thread accumulators
+    if(nthreads > 1 && (buffers.Rows() != 3*(nthreads-1)
+                        || buffers.Columns() != N)){
+        buffers = Matrix(3*(nthreads-1), N);
+    }
+    energies.assign(nthreads, 0);
+    scratch.resize(nthreads);
     
-    // factors for adjusting the forces and distances:
-    double rABinv = (1.0/0.8);
-    double rBBinv = (1.0/0.88);
-    double fAB = 1.5*rABinv*rABinv;
-    double fBB = 0.5*rBBinv*rABinv;
+    Kernels::Table table = {ntypes, sidelength, &epsilon[0], &sigma2[0],
+                            &rcut2[0], &eshift[0]};
+    const int* type = &species[0];
+    NeighborList& list = (part == 1) ? inner : neighbors;
     
-    // The force loop - AA interactions
-    for(i=0;i<Na;i++){
-        for(j=i+1;j<Na;j++){
-            // calculating the radius
-            r2 = 0;
-            for(k=0;k<3;k++){
-                rij[k] = r[i][k] - r[j][k];
-                // imposing periodic boundary conditions
-                rij[k] -= sidelength*fastround(rij[k]*Linv);
-                r2 += rij[k]*rij[k];
+    // Mixed precision goes through the Mixed kernel, and tabulated
+    // potentials through the Tabulated kernel. Binning goes through the
+    // scalar kernel, into per-thread histograms; the parts of a split
+    // potential through the Split kernel, binned on the outer part (which
+    // sees every pair)
+    Kernels::Kernel pairkernel = Energy ? kernel : Kernels::ForcesOnly(kernel);
+    int hsize = ntypes*ntypes*hbins;
+    bool bin = binning && part != 1;
+    if(mixed){
+        int pairs = ntypes*ntypes;
+        singles.resize(4*pairs);
+        for(int t=0;t<pairs;t++){
+            singles[t] = float(epsilon[t]);
+            singles[pairs+t] = float(sigma2[t]);
+            singles[2*pairs+t] = float(rcut2[t]);
+            singles[3*pairs+t] = float(eshift[t]);
+        }
+        pairkernel = Kernels::MixedFor(kernel);
+        table.epsilonf = &singles[0];
+        table.sigma2f = &singles[pairs];
+        table.rcut2f = &singles[2*pairs];
+        table.eshiftf = &singles[3*pairs];
+    }
+    if(shape != ""){
+        pairkernel = Kernels::TabulatedFor(kernel);
+        table.tables = tables.Coefficients();
+        table.tablemin = tables.Lower();
+        table.tablescale = tables.Scale();
+        table.tablebins = tables.Bins();
+    }
+    if(part != 0){
+        pairkernel = (shape != "") ? Kernels::Split : Kernels::SplitFor(kernel);
+        table.part = part;
+        table.switch1 = switch1;
+        table.width = width;
+    }
+    if(bin){
+        double range = HistogramRange();
+        pairkernel = (part == 2) ? Kernels::Split : Kernels::Binned;
+        if(int(histogram.size()) != nthreads*hsize){
+            // keeping what was binned with a different number of threads
+            std::vector<double> old(histogram);
+            histogram.assign(nthreads*hsize, 0);
+            for(int j=0;j<int(old.size());j++){histogram[j%hsize] += old[j];}
+        }
+        table.bins = hbins;
+        table.binscale = hbins/range;
+        table.range2 = range*range;
+        hframes++;
+    }
+    
+    Pool::Parallel([&](int t){
+        int i, k, c, s, p, start;
+        double** force = (t==0) ? f : buffers.Data() + 3*(t-1);
+        double energy = 0;
+        std::vector<int>& shell = scratch[t];
+        Kernels::Table mine = table;
+        if(bin){mine.histogram = &histogram[t*hsize];}
+        
+        // Zero out the forces
+        for(k=0;k<3;k++){for(i=0;i<N;i++){force[k][i]=0;};};
+        
+        if(UsingNeighbors()){
+            // The neighbor loop
+            for(i=t;i<N;i+=nthreads){
+                start = list.Start(i);
+                energy += pairkernel(i, list.List() + start,
+                                     list.End(i) - start, r, force, type,
+                                     mine);
             }
-            r2inv = (1.0)/r2;
-            r6inv = r2inv*r2inv*r2inv;
-            // Updating the potential energy
-            potential_energy += 4*r6inv*(r6inv-1);
-            // Updating the forces
-            fij = r6inv*r2inv*(r6inv-0.5);
-            for(k=0;k<3;k++){
-                f[i][k] += fij*rij[k];
-                f[j][k] -= fij*rij[k];
+        } else if(cells.Active()){
+            // The cell loop: the members of cell c followed by those of its
+            // half-shell; each member interacts with everyone after it.
+            for(c=t;c<cells.Count();c+=nthreads){
+                shell.clear();
+                for(i=cells.Head(c);i>=0;i=cells.Next(i)){shell.push_back(i);}
+                for(s=0;s<13;s++){
+                    for(i=cells.Head(cells.Neighbor(c,s));i>=0;
+                        i=cells.Next(i)){shell.push_back(i);}
+                }
+                for(p=0,i=cells.Head(c);i>=0;p++,i=cells.Next(i)){
+                    energy += pairkernel(i, shell.data()+p+1,
+                                         int(shell.size())-p-1, r, force, type,
+                                         mine);
+                }
             }
-        }
-        // AB interactions - sigma = 0.8, epsilon = 1.5
-        for(j=Na;j<N;j++){
-            r2 = 0;
-            for(k=0;k<3;k++){
-                rij[k] = (r[i][k] - r[j][k]);
-                rij[k] -= sidelength*fastround(rij[k]*Linv);
-                // effective radius adjusted by sigma
-                rij[k] *= rABinv;
-                r2 += rij[k]*rij[k];
+        } else {
+            // The force loop (dun dun duuuuun), rows dealt out round-robin
+            // to balance the triangle
+            for(i=t;i<N;i+=nthreads){
+                energy += pairkernel(i, identity.data()+i+1, N-i-1, r, force,
+                                     type, mine);
             }
-            r2inv = (1.0)/r2;
-            r6inv = r2inv*r2inv*r2inv;
-            // energy and forces adjusted by epsilon and force-factor
-            potential_energy += (1.5)*4*r6inv*(r6inv-1);
-            fij = fAB*r6inv*r2inv*(r6inv-0.5);
-            for(k=0;k<3;k++){
-                f[i][k] += fij*rij[k];
-                f[j][k] -= fij*rij[k];
+        }
+        energies[t] = energy;
+    });
+    // Reducing the thread buffers into f, each thread taking a block of rows
+    if(nthreads > 1){
+        Pool::Parallel([&](int t){
+            int i, k, b;
+            double *fk, *bk;
+            for(b=0;b<nthreads-1;b++){
+                for(k=0;k<3;k++){
+                    fk = f[k];
+                    bk = buffers.Data()[3*b+k];
+                    for(i=(t*N)/nthreads;i<((t+1)*N)/nthreads;i++){
+                        fk[i] += bk[i];
+                    }
+                }
             }
+        });
+    }
+    if(Energy){
+        potential_energy = 0;
+        for(int t=0;t<nthreads;t++){potential_energy += energies[t];}
+        if(part == 1){
+            inner_energy = potential_energy;
+            potential_energy += outer_energy;
+        } else if(part == 2){
+            outer_energy = potential_energy;
+            potential_energy += inner_energy;
         }
     }
-    // BB interactions - sigma = 0.88, epsilon = 0.5
-    for(i=Na;i<N;i++){
-        for(j=i+1;j<N;j++){
-            r2 = 0;
-            for(k=0;k<3;k++){
-                rij[k] = r[i][k] - r[j][k];
-                rij[k] -= sidelength*fastround(rij[k]*Linv);
-                // effective radius adjusted by sigma
-                rij[k] *= rBBinv;
-                r2 += rij[k]*rij[k];
-            }
-            r2inv = (1.0)/r2;
-            r6inv = r2inv*r2inv*r2inv;
-            // Update me!!
-            potential_energy += (0.5)*4*r6inv*(r6inv-1);
-            fij = fBB*r6inv*r2inv*(r6inv-0.5);
-            for(k=0;k<3;k++){
-                f[i][k] += fij*rij[k];
-                f[j][k] -= fij*rij[k];
-            }
+    if(Profiler::Enabled()){
+        Profiler::Add(Profiler::Evaluations, 1);
+        Profiler::Add(Profiler::Pairs, (part == 1) ?
+                      long(N*inner.AverageLength()) :
+                      long(PairsPerEvaluation()));
+    }
+    return;
+}
+
+template void Particles::PairForces<true>();
+template void Particles::PairForces<false>();
+
+void Particles::BinParticles(){
+    /* Bins every particle into the cell list, for EnergyChange. */
+    if(cells.Active()){cells.Build(r, N);}
+    return;
+}
+
+double Particles::EnergyChange(int i, const double* x){
+    /* The change in the potential energy if particle i were moved from where
+    it is to x: the energy of its pairs at x less that of its pairs where it
+    is. With the cell list, only the particles in the cells around each spot
+    are looked at (a single pass when both are in the same cell), and every
+    particle otherwise. Uses the tabulated potential if there is one, always
+    in double precision. */
+    int j, s, from, to;
+    int base = species[i]*ntypes;
+    double here[3] = {r[0][i], r[1][i], r[2][i]};
+    double change = 0, Linv = 1.0/sidelength;
+    bool tabulated = (shape != "");
+    if(ntypes == 0){return 0;}
+    Kernels::Table table = {ntypes, sidelength};
+    table.tables = tables.Coefficients();
+    table.tablemin = tables.Lower();
+    table.tablescale = tables.Scale();
+    table.tablebins = tables.Bins();
+    // lambda for the energy of the pair of j and a particle of i's species
+    // at the point a
+    auto pair = [&](int j, const double* a){
+        int k, t = base + species[j];
+        double d, r2 = 0, s2, s6, fij;
+        for(k=0;k<3;k++){
+            d = a[k] - r[k][j];
+            d -= sidelength*fastround(d*Linv);
+            r2 += d*d;
+        }
+        if(r2 >= rcut2[t]){return 0.0;}
+        if(tabulated){return Kernels::Spline(table, t, r2, fij);}
+        s2 = sigma2[t]/r2;
+        s6 = s2*s2*s2;
+        return 4*epsilon[t]*s6*(s6-1) - eshift[t];
+    };
+    if(!cells.Active()){
+        for(j=0;j<N;j++){
+            if(j != i){change += pair(j, x) - pair(j, here);}
+        }
+        return change;
+    }
+    from = cells.Locate(here[0], here[1], here[2]);
+    to = cells.Locate(x[0], x[1], x[2]);
+    for(s=0;s<27;s++){
+        for(j=cells.Head(cells.Around(from,s));j>=0;j=cells.Next(j)){
+            if(j == i){continue;}
+            change -= pair(j, here);
+            if(from == to){change += pair(j, x);}
         }
     }
+    if(from == to){return change;}
+    for(s=0;s<27;s++){
+        for(j=cells.Head(cells.Around(to,s));j>=0;j=cells.Next(j)){
+            if(j != i){change += pair(j, x);}
+        }
+    }
+    return change;
+}
+
+void Particles::MoveParticle(int i, const double* x, double change){
+    /* Puts particle i at x, moving it over to its new cell, and adds the
+    change in energy (from EnergyChange) to the potential energy. */
+    if(cells.Active()){
+        cells.Move(i, cells.Locate(r[0][i], r[1][i], r[2][i]),
+                   cells.Locate(x[0], x[1], x[2]));
+    }
+    for(int k=0;k<3;k++){r[k][i] = x[k];}
+    potential_energy += change;
+    return;
+}
+
+/* The Lennard-Jones Fluid -------------------------------------------------- */
+
+void Fluid::UpdateForces(){
+    /* Exicutes the forceloop for the simple Lennard-Jones fluid, updating the
+    forces and potential energy. */
+    PairForces<true>();
+    return;
+}
+
+/* The Kob-Anderson Glass --------------------------------------------------- */
+
+void Glass::Mixture(){
+    /* Makes the last 20% of the particles B particles, and sets the
+    Kob-Anderson pair parameters:
+    AA: sigma = 1.0,  epsilon = 1.0
+    AB: sigma = 0.8,  epsilon = 1.5
+    BB: sigma = 0.88, epsilon = 0.5 */
+    for(int i=Na;i<N;i++){species[i] = 1;}
+    SetTypes(2);
+    SetPair(0, 0, 1.0, 1.0);
+    SetPair(0, 1, 1.5, 0.8);
+    SetPair(1, 1, 0.5, 0.88);
+    return;
+}
+
+void Glass::UpdateForces(){
+    /* Excicutes the forceloop for the Kob-Anderson glass mixture, updating the
+    forces and potential energy. */
+    PairForces<true>();
     return;
 }
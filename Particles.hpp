@@ -13,10 +13,19 @@ under simulation.
 #ifndef Particles_hpp
 #define Particles_hpp
 
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <fstream>
 #include <iostream>
+#include <vector>
 #include "Matrix.hpp"
+#include "Cells.hpp"
+#include "Checkpoint.hpp"
+#include "Kernels.hpp"
+#include "Pool.hpp"
+#include "Profiler.hpp"
+#include "Tables.hpp"
 #include "chaos.hpp"
 
 class Particles{
@@ -24,16 +33,28 @@ class Particles{
     public:
         // Constructors
         Particles(double rho, int Nside):
-            rho(rho), Nside(Nside), time(0),
-            kinetic_energy(0), potential_energy(0) {Initialize();};
+            rho(rho), Nside(Nside), time(0), cutoff(0), ntypes(0),
+            kinetic_energy(0), potential_energy(0),
+            kernel(Kernels::Select("auto")), hbins(0), hframes(0),
+            binning(false), part(0), switch1(0), width(0), inner_energy(0),
+            outer_energy(0), shape(""), tablebins(0), mixed(false),
+            reorder(0), since(0), reordered(false) {Initialize();};
         void Initialize();
-        // Accessors
+        // Accessors. The particle arrays are stored as structures of arrays:
+        // r[k][i] is component k of particle i, so r[0], r[1] and r[2] are
+        // the x, y and z arrays, each contiguous and cache-line aligned.
         double** r;
         double** v;
         double** f;
-        inline Matrix Positions(){return positions;};
-        inline Matrix Velocities(){return velocities;};
-        inline Matrix Forces(){return forces;};
+        inline const int* Species(){return &species[0];};
+        // Index of each particle in the system as first set up (the same as
+        // its place in the arrays, unless the system moves them around)
+        inline const int* IDs(){return &ids[0];};
+        inline int Types(){return ntypes;};
+        // (N x 3) copies, one row per particle
+        inline Matrix Positions(){return positions.Transpose();};
+        inline Matrix Velocities(){return velocities.Transpose();};
+        inline Matrix Forces(){return forces.Transpose();};
         inline double KE() {UpdateKinetic(); return kinetic_energy;};
         inline double PE() {return potential_energy;};
         inline double TotalEnergy() {return kinetic_energy + potential_energy;}
@@ -41,19 +62,136 @@ class Particles{
         inline double Number(){return N;};
         inline double Time(){return time;};
         inline void setTime(double t){time = t;};
+        inline double Cutoff(){return cutoff;};
+        inline bool UsingCells(){return cells.Active();};
+        inline bool UsingNeighbors(){return neighbors.Active() && cutoff>0;};
         // Common Operations
-        void UpdateKinetic();
-        void Thermalize(double Temp);
+        virtual void UpdateKinetic();
+        virtual void Thermalize(double Temp);
         // Integration calculations
         virtual void UpdateForces(){return;};
-        // File Operations 
-        void SaveTrajectory();
+        // Sorting the particles along a Morton (Z-order) curve every so many
+        // calls of Reorder (0 = never), so that particles close together in
+        // space are close together in memory. The integrators call Reorder
+        // between steps; it returns true if it moved the particles, and
+        // Permutation()[i] is then the old place of the particle now at i.
+        // IDs() keeps track of the original order, which the trajectory and
+        // correlators are written in.
+        inline void SetReorder(int every){reorder = every; since = 0;};
+        inline int ReorderEvery(){return reorder;};
+        inline bool Reordered(){return reordered;};
+        bool Reorder();
+        inline const int* Permutation(){return &permutation[0];};
+        // Systems split over processes (see Domain.hpp): Migrate hands the
+        // particles that have left this process's part of the box on to
+        // their new owners, and is called by the integrators between steps.
+        // Only the Writer process writes the output, from the whole system
+        // gathered by Output.
+        virtual void Migrate(){return;};
+        virtual bool Writer(){return true;};
+        virtual Particles* Output(){return this;};
+        // The Lennard-Jones pair forces, and with Energy the potential energy,
+        // called directly by the templated integrators (see Potentials.hpp)
+        template<bool Energy> void PairForces();
+        // Single particle moves, for Monte Carlo (see MonteCarlo in
+        // Integration.hpp). BinParticles sorts the particles into the cell
+        // list, if there is one. EnergyChange is then the change in the
+        // potential energy were particle i moved to x, from i's pairs alone
+        // (found in the cells around it), and MoveParticle moves it there,
+        // keeping the cell list up to date and adding the change to PE.
+        void BinParticles();
+        double EnergyChange(int i, const double* x);
+        void MoveParticle(int i, const double* x, double change);
+        void SetCutoff(double rc);
+        void SetSkin(double skin);
+        void NeighborStats();
+        double PairsPerEvaluation();
+        void SetKernel(std::string name);
+        inline std::string KernelName(){return Kernels::Name(kernel);};
+        bool CheckKernel(double tolerance);
+        // Precision of the pair math: "double", or "mixed" for single
+        // precision pair math with double positions and sums (see Kernels)
+        void SetPrecision(std::string name);
+        inline std::string Precision(){return mixed ? "mixed" : "double";};
+        // Tabulated pair potentials (see Tables.hpp): the named shape, with
+        // the pair parameters of the system, interpolated from bins spline
+        // bins per species pair; "analytic" goes back to the Lennard-Jones
+        // kernels. CheckTables compares the tables against the exact shape,
+        // and tabulated LJ against the analytic kernel.
+        void SetPotential(std::string name, int bins);
+        inline std::string Potential(){return shape=="" ? "analytic" : shape;};
+        bool CheckTables(double tolerance);
+        // Pair distance histograms, filled by the force evaluations made
+        // while binning is switched on
+        void SetHistogram(int bins);
+        inline bool Histogramming(){return hbins > 0;};
+        inline void BinPairs(bool on){binning = on && hbins > 0;};
+        inline bool BinningPairs(){return binning;};
+        void SavePairDistribution(std::string filename);
+        // The potential split into inner and outer parts for r-RESPA, the
+        // switch going from 1 to 0 between r1 and r1 + width (width = 0 for
+        // no split; see Kernels::Split). Each of InnerForces and OuterForces
+        // leaves its own part in f, and the sum of the last of each in PE.
+        void SetSplit(double r1, double width);
+        inline bool Splitting(){return width > 0;};
+        void InnerForces();
+        void OuterForces();
+        // Checkpointing the dynamical state (and the pair histograms)
+        void Save(Checkpoint& out);
+        void Load(Checkpoint& in);
         //virtual void SelfScattering(){return;}; to be implemented later
     protected:
         Matrix positions, velocities, forces;
         int N, Nside;
-        double lengthscale, sidelength, rho, time;
+        double lengthscale, sidelength, rho, time, cutoff;
         double kinetic_energy, potential_energy;
+        // Lennard-Jones pair interactions between species, tabulated by the
+        // pair index a*ntypes+b. Used by Fluid and Glass.
+        void SetTypes(int n);
+        void SetPair(int a, int b, double eps, double sigma);
+        void BuildNeighbors(double Linv);
+        void BuildInner(double Linv);
+        std::vector<int> species, ids;
+        int ntypes;
+        std::vector<double> epsilon, sigma2, rcut2, eshift, rlist2;
+        CellList cells;
+        NeighborList neighbors;
+        // Pair kernel, and the list of every particle index it is handed by
+        // the all-pairs loop
+        Kernels::Kernel kernel;
+        std::vector<int> identity;
+        // Per-thread force buffers, energies and partner lists for the
+        // threaded force loop
+        Matrix buffers;
+        std::vector<double> energies;
+        std::vector<std::vector<int> > scratch;
+        // Per-thread pair histograms, by species pair and then bin, and the
+        // number of configurations binned into them
+        double HistogramRange();
+        int hbins;
+        long hframes;
+        bool binning;
+        std::vector<double> histogram;
+        // The part of the split potential being evaluated (0 = all of it),
+        // the switching shell, the energy of each part, and the list of the
+        // pairs within reach of the inner part
+        int part;
+        double switch1, width, inner_energy, outer_energy;
+        NeighborList inner;
+        // The tabulated potential ("" for analytic Lennard-Jones)
+        std::string shape;
+        int tablebins;
+        PairTable tables;
+        // Mixed precision, and the single precision copies of the pair table
+        // (epsilon, sigma2, rcut2 and eshift, one after the other)
+        bool mixed;
+        std::vector<float> singles;
+        // Reordering: every how many calls, the calls since the last one,
+        // whether the particles have ever been moved, and the last move
+        int reorder;
+        long since;
+        bool reordered;
+        std::vector<int> permutation;
 };
 
 class Free: public Particles {
@@ -68,7 +206,9 @@ class Fluid: public Particles {
     /* Derived class for simple Lennard-Jones fluid */
     public:
         Fluid(double rho, double T, double nside):
-            Particles(rho, nside) {UpdateForces(); Thermalize(T);};
+            Particles(rho, nside) {
+                SetTypes(1); SetPair(0, 0, 1.0, 1.0);
+                UpdateForces(); Thermalize(T);};
         void UpdateForces();
     //protected:
 };
@@ -77,9 +217,10 @@ class Glass: public Particles {
     /* Derived class for the Kob-Anderson glass mixture */
     public:
         Glass(double rho, double T, double nside):
-            Particles(rho, nside) {UpdateForces(); Thermalize(T);};
+            Particles(rho, nside) {Mixture(); UpdateForces(); Thermalize(T);};
         void UpdateForces();
     protected:
+        void Mixture();
         int Na = int(0.8*N);
         int Nb = N - Na;
 };
@@ -0,0 +1,105 @@
+/*
+Glassy Dynamics Simulation Module: Pool
+Created by Joe Raso, Sat Oct 17 20:42:58 UTC 2026
+Copyright © 2019 Joe Raso, All rights reserved.
+*/
+
+#include "Pool.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+    // Shared state of the pool. A new parallel region is signaled by bumping
+    // "generation"; the workers count themselves back in with "pending".
+    std::vector<std::thread> workers;
+    std::mutex lock;
+    std::condition_variable wake, done;
+    const std::function<void(int)>* job = 0;
+    long generation = 0;
+    int pending = 0;
+    bool stopping = false;
+    thread_local bool inside = false;
+
+    void Work(int t, long seen){
+        /* Main loop of worker thread t, which has already seen parallel
+        regions up to "seen". */
+        inside = true;
+        while(true){
+            std::unique_lock<std::mutex> hold(lock);
+            wake.wait(hold, [&]{return stopping || generation != seen;});
+            if(stopping){return;}
+            seen = generation;
+            const std::function<void(int)>* task = job;
+            hold.unlock();
+            (*task)(t);
+            hold.lock();
+            if(--pending == 0){done.notify_one();}
+        }
+    }
+}
+
+void Pool::Start(int n){
+    /* Starts n-1 worker threads; the calling thread is the n-th. */
+    Stop();
+    if(n < 1){n = 1;}
+    std::cout << "Starting thread pool with " << n << " threads" << std::endl;
+    std::lock_guard<std::mutex> hold(lock);
+    stopping = false;
+    for(int t=1;t<n;t++){workers.push_back(std::thread(Work, t, generation));}
+    return;
+}
+
+void Pool::Stop(){
+    /* Joins all of the worker threads. */
+    {
+        std::lock_guard<std::mutex> hold(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for(size_t t=0;t<workers.size();t++){workers[t].join();}
+    workers.clear();
+    return;
+}
+
+int Pool::Size(){
+    /* Number of threads, counting the caller. Inside a parallel region only
+    the calling thread is available. */
+    if(inside){return 1;}
+    return int(workers.size()) + 1;
+}
+
+void Pool::Parallel(const std::function<void(int)>& task){
+    /* Runs the task on every thread and waits for them to finish. */
+    int n = Size();
+    if(n == 1){
+        task(0);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> hold(lock);
+        job = &task;
+        pending = n - 1;
+        generation++;
+    }
+    wake.notify_all();
+    inside = true;
+    task(0);
+    inside = false;
+    std::unique_lock<std::mutex> hold(lock);
+    done.wait(hold, []{return pending == 0;});
+    return;
+}
+
+void Pool::Tasks(int count, const std::function<void(int)>& task){
+    /* Runs the numbered tasks, each thread taking the next one off a shared
+    counter whenever it finishes one. */
+    std::atomic<int> next(0);
+    Parallel([&](int){
+        for(int j=next++;j<count;j=next++){task(j);}
+    });
+    return;
+}
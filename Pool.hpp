@@ -0,0 +1,41 @@
+/*
+Glassy Dynamics Simulation Module: Pool
+Created by Joe Raso, Sat Oct 17 20:42:58 UTC 2026
+Copyright © 2019 Joe Raso, All rights reserved.
+
+This module contains the namespace "Pool", a fixed set of worker threads that
+is started once in main.cpp and shared by the whole simulation. Work is handed
+out as parallel regions: every thread runs the same task with its own thread
+index, and the call returns once they have all finished. The calling thread
+takes part as thread 0, so a pool of size 1 runs everything serially.
+
+Independent jobs of uneven length (like the replicas of an ensemble) are
+handed out with Tasks instead: each thread takes the next job as soon as it is
+done with its last, so none sit idle while there is work left. Anything run
+inside a parallel region sees a pool of size 1, so nested regions (the force
+loop of a replica, say) simply run serially on their own thread.
+*/
+
+#ifndef Pool_hpp
+#define Pool_hpp
+
+#include <functional>
+#include <iostream>
+
+namespace Pool {
+    void Start(int);
+    //Starts the pool with the given number of threads (including the
+    //calling thread).
+    void Stop();
+    //Joins the worker threads.
+    int Size();
+    //Number of threads in the pool (1 inside a parallel region).
+    void Parallel(const std::function<void(int)>&);
+    //Runs task(t) for every thread index t, and waits for all of them. When
+    //called from inside a parallel region it just runs task(0).
+    void Tasks(int, const std::function<void(int)>&);
+    //Runs task(j) for j = 0 ... count-1, spread dynamically over the
+    //threads, and waits for all of them.
+};
+
+#endif /*Pool_hpp*/
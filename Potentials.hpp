@@ -0,0 +1,47 @@
+/*
+Glassy Dynamics Simulation Module: Potentials
+Created by Joe Raso, Sat Oct 17 21:35:29 UTC 2026
+Copyright © 2019 Joe Raso, All rights reserved.
+
+This module contains the potentials as compile-time types, for the templated
+integrators (VerletT in Integration.hpp). Each one names the particle system
+it goes with (System), and works out its forces with a static Forces<Energy>
+that calls straight into that system's force loop, so the step loop of the
+integrator is compiled against the one potential, with no virtual call in
+between. Energy says whether the potential energy is wanted: without it the
+pair kernels skip the energy sum, which is only worth doing on the steps that
+are recorded.
+
+The polymorphic route (an Integrator holding a Particles*, calling the virtual
+UpdateForces) is still there, and is what everything else uses.
+*/
+
+#ifndef Potentials_hpp
+#define Potentials_hpp
+
+#include "Particles.hpp"
+
+struct FreePotential {
+    /* No interactions at all */
+    typedef Free System;
+    template<bool Energy>
+    static inline void Forces(Free* system){system->Free::UpdateForces();};
+};
+
+struct FluidPotential {
+    /* The single species Lennard-Jones fluid */
+    typedef Fluid System;
+    template<bool Energy>
+    static inline void Forces(Fluid* system){
+        system->template PairForces<Energy>();};
+};
+
+struct GlassPotential {
+    /* The Kob-Anderson Lennard-Jones mixture */
+    typedef Glass System;
+    template<bool Energy>
+    static inline void Forces(Glass* system){
+        system->template PairForces<Energy>();};
+};
+
+#endif /*Potentials_hpp*/
@@ -0,0 +1,268 @@
+/*
+Glassy Dynamics Simulation Module: Profiler
+Created by Joe Raso, Sat Oct 17 21:15:37 UTC 2026
+Copyright © 2019 Joe Raso, All rights reserved.
+*/
+
+#include "Profiler.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+bool Profiler::enabled = false;
+
+namespace {
+    // Names of the regions and counters, in the order of their enums
+    const char* regions[Profiler::Regions] = {"run", "equilibrate",
+        "propigate", "forces", "neighbor lists", "halo exchange",
+        "reordering", "thermostat", "trajectory", "energy files",
+        "correlators", "checkpoints"};
+    const char* counters[Profiler::Counters] = {"steps", "force evaluations",
+        "pair interactions", "trajectory frames"};
+    const char* hardwarenames[3] = {"cycles", "instructions", "cache misses"};
+    
+    // One finished scope, for the trace
+    struct Event {
+        int region;
+        int64_t start, duration;
+    };
+    
+    // Everything one thread has timed and counted
+    struct Tally {
+        int thread;
+        long calls[Profiler::Regions];
+        int64_t total[Profiler::Regions], self[Profiler::Regions];
+        long counts[Profiler::Counters];
+        uint64_t hardware[3];
+        int fd[3];
+        bool opened;
+        std::vector<Event> events;
+        long dropped;
+        Profiler::Scope* current;
+    };
+    
+    // The tallies of every thread that has opened a scope; they are kept
+    // after the thread is gone
+    std::mutex lock;
+    std::vector<std::unique_ptr<Tally> > tallies;
+    thread_local Tally* mine = 0;
+    std::string tracefile = "";
+    bool hardware = false;
+    int64_t origin = 0;
+    // Trace events kept per thread, beyond which they are just counted
+    const size_t maxevents = 1 << 20;
+    
+    inline int64_t Clock(){
+        /* Nanoseconds on the steady clock. */
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+    
+    Tally& Mine(){
+        /* The calling thread's tally, made on first use. */
+        if(mine == 0){
+            std::lock_guard<std::mutex> hold(lock);
+            tallies.push_back(std::unique_ptr<Tally>(new Tally()));
+            mine = tallies.back().get();
+            mine->thread = int(tallies.size()) - 1;
+            for(int k=0;k<3;k++){mine->fd[k] = -1;}
+        }
+        return *mine;
+    }
+    
+    void Read(Tally& t, uint64_t values[3]){
+        /* Reads the hardware counters of the calling thread, opening them
+        the first time. Counters that can't be opened read 0. */
+        for(int k=0;k<3;k++){values[k] = 0;}
+#ifdef __linux__
+        if(!t.opened){
+            t.opened = true;
+            const uint64_t config[3] = {PERF_COUNT_HW_CPU_CYCLES,
+                PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES};
+            for(int k=0;k<3;k++){
+                perf_event_attr attr = perf_event_attr();
+                attr.size = sizeof(attr);
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.config = config[k];
+                attr.exclude_kernel = 1;
+                attr.exclude_hv = 1;
+                t.fd[k] = int(syscall(__NR_perf_event_open, &attr, 0, -1, -1,
+                                      0));
+            }
+            if(t.fd[0] < 0){
+                std::cout << "Warning: hardware counters unavailable "
+                          << "(perf_event_open refused)" << std::endl;
+            }
+        }
+        for(int k=0;k<3;k++){
+            if(t.fd[k] >= 0 && read(t.fd[k], &values[k], sizeof(uint64_t))
+               != sizeof(uint64_t)){values[k] = 0;}
+        }
+#endif
+        return;
+    }
+}
+
+void Profiler::Enable(bool on){
+    /* Switches the timers on or off. Call it before the threads start. */
+    enabled = on;
+    if(on && origin == 0){origin = Clock();}
+    return;
+}
+
+void Profiler::SetTrace(std::string filename){
+    /* Records every scope, to be written to the given Chrome trace file by
+    WriteTrace. Switches the timers on. */
+    tracefile = filename;
+    Enable(true);
+    return;
+}
+
+void Profiler::SetHardware(bool on){
+    /* Wraps the force evaluations in hardware counters. Switches the timers
+    on. */
+    hardware = on;
+    if(on){Enable(true);}
+    return;
+}
+
+void Profiler::Add(Counter c, long n){
+    Mine().counts[c] += n;
+    return;
+}
+
+void Profiler::Scope::Begin(){
+    /* Starts the clock, and the hardware counters for a force evaluation. */
+    Tally& t = Mine();
+    parent = t.current;
+    t.current = this;
+    children = 0;
+    if(hardware && region == Forces){Read(t, counted);}
+    start = Clock();
+    return;
+}
+
+void Profiler::Scope::End(){
+    /* Charges the time since Begin to the region, and to the enclosing
+    scope's children. */
+    int64_t duration = Clock() - start;
+    Tally& t = *mine;
+    t.calls[region]++;
+    t.total[region] += duration;
+    t.self[region] += duration - children;
+    if(parent){parent->children += duration;}
+    t.current = parent;
+    if(hardware && region == Forces){
+        uint64_t now[3];
+        Read(t, now);
+        for(int k=0;k<3;k++){t.hardware[k] += now[k] - counted[k];}
+    }
+    if(tracefile != ""){
+        if(t.events.size() < maxevents){
+            Event e = {region, start - origin, duration};
+            t.events.push_back(e);
+        } else {
+            t.dropped++;
+        }
+    }
+    return;
+}
+
+void Profiler::Summary(){
+    /* Prints the time spent in each region, added up over the threads: the
+    calls, the total and self times, each region's share of all the self
+    time, and the mean time per call. Then the counters, and the hardware
+    counts of the force evaluations. */
+    int r, c, k;
+    if(!enabled){return;}
+    std::lock_guard<std::mutex> hold(lock);
+    long calls[Regions] = {0}, counts[Counters] = {0};
+    int64_t total[Regions] = {0}, self[Regions] = {0}, timed = 0;
+    uint64_t hw[3] = {0, 0, 0};
+    for(size_t n=0;n<tallies.size();n++){
+        Tally& t = *tallies[n];
+        for(r=0;r<Regions;r++){
+            calls[r] += t.calls[r];
+            total[r] += t.total[r];
+            self[r] += t.self[r];
+            timed += t.self[r];
+        }
+        for(c=0;c<Counters;c++){counts[c] += t.counts[c];}
+        for(k=0;k<3;k++){hw[k] += t.hardware[k];}
+    }
+    printf("\nProfile: %.6f s wall, %d threads timed\n", 1e-9*(Clock()-origin),
+           int(tallies.size()));
+    printf("%-16s %10s %14s %14s %8s %14s\n", "region", "calls", "total (s)",
+           "self (s)", "self %", "mean (us)");
+    for(r=0;r<Regions;r++){
+        if(calls[r] == 0){continue;}
+        printf("%-16s %10ld %14.6f %14.6f %8.2f %14.3f\n", regions[r],
+               calls[r], 1e-9*total[r], 1e-9*self[r],
+               (timed > 0) ? 100.0*self[r]/timed : 0.0,
+               1e-3*total[r]/calls[r]);
+    }
+    for(c=0;c<Counters;c++){
+        if(counts[c] > 0){printf("%-20s %ld\n", counters[c], counts[c]);}
+    }
+    if(counts[Pairs] > 0 && total[Forces] > 0){
+        printf("%-20s %.4g per second of force evaluation\n", "pair rate",
+               counts[Pairs]/(1e-9*total[Forces]));
+    }
+    if(hardware && hw[0] > 0){
+        printf("Force evaluations (calling thread):\n");
+        for(k=0;k<3;k++){
+            printf("  %-18s %llu", hardwarenames[k], (unsigned long long)hw[k]);
+            if(counts[Pairs] > 0){
+                printf("  (%.4g per pair)", double(hw[k])/counts[Pairs]);
+            }
+            printf("\n");
+        }
+        printf("  %-18s %.3f\n", "instructions/cycle", double(hw[1])/hw[0]);
+    } else if(hardware){
+        printf("Hardware counters read nothing (no access to the PMU?)\n");
+    }
+    fflush(stdout);
+    return;
+}
+
+void Profiler::WriteTrace(){
+    /* Writes the recorded scopes as complete ("X") events of a Chrome trace,
+    with times in microseconds and one track per thread. */
+    if(tracefile == ""){return;}
+    std::lock_guard<std::mutex> hold(lock);
+    FILE* out = fopen(tracefile.c_str(), "w");
+    if(out == 0){
+        std::cout << "Error opening trace file " << tracefile << "!"
+                  << std::endl;
+        exit(1);
+    }
+    fprintf(out, "{\"traceEvents\": [\n");
+    bool first = true;
+    long dropped = 0;
+    for(size_t n=0;n<tallies.size();n++){
+        Tally& t = *tallies[n];
+        dropped += t.dropped;
+        for(size_t e=0;e<t.events.size();e++){
+            fprintf(out, "%s{\"name\": \"%s\", \"cat\": \"glassius\", "
+                    "\"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": 1, "
+                    "\"tid\": %d}", first ? "" : ",\n",
+                    regions[t.events[e].region], 1e-3*t.events[e].start,
+                    1e-3*t.events[e].duration, t.thread);
+            first = false;
+        }
+    }
+    fprintf(out, "\n], \"displayTimeUnit\": \"ns\"}\n");
+    fclose(out);
+    std::cout << "Trace written to " << tracefile;
+    if(dropped > 0){std::cout << " (" << dropped << " events dropped)";}
+    std::cout << std::endl;
+    return;
+}
@@ -0,0 +1,64 @@
+/*
+Glassy Dynamics Simulation Module: Profiler
+Created by Joe Raso, Sat Oct 17 21:15:37 UTC 2026
+Copyright © 2019 Joe Raso, All rights reserved.
+
+This module contains the namespace "Profiler", nanosecond timers for the
+stages of a run. A Profiler::Scope object times the block it is declared in
+and charges it to one of the regions below; scopes nest, so every region gets
+both its total time and its "self" time (the total less the regions inside
+it). Counters tally things like steps and pair interactions. Each thread keeps
+its own tallies, so the ensemble replicas can all be profiled at once.
+
+Switched off (the default), a scope costs one test of a flag. Switched on, it
+reads the steady clock on the way in and out. At the end of the run Summary
+prints a table of the regions and counters. The individual scopes can also be
+recorded and written as a Chrome trace (chrome://tracing or Perfetto), and on
+Linux the force evaluations can be wrapped in hardware counters (cycles,
+instructions, cache misses) with perf_event, where the kernel allows it. The
+hardware counters only count the thread that called the force loop.
+*/
+
+#ifndef Profiler_hpp
+#define Profiler_hpp
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+namespace Profiler {
+    // The regions timed, and the counters kept
+    enum Region {Run, Equilibrate, Propigate, Forces, Neighbors, Exchange,
+                 Reorder, Thermostat, Trajectory, Energies, Correlators,
+                 Checkpoints, Regions};
+    enum Counter {Steps, Evaluations, Pairs, Frames, Counters};
+    extern bool enabled;
+    // Switching on the timers, the trace and the hardware counters
+    void Enable(bool on);
+    inline bool Enabled(){return enabled;};
+    void SetTrace(std::string filename);
+    void SetHardware(bool on);
+    // Adds n to a counter
+    void Add(Counter c, long n);
+    inline void Count(Counter c, long n){if(enabled){Add(c, n);}};
+    class Scope{
+        /* Times its own lifetime, as one call of the region */
+        public:
+            inline Scope(Region r): region(r), active(enabled) {
+                if(active){Begin();}};
+            inline ~Scope(){if(active){End();}};
+        protected:
+            void Begin();
+            void End();
+            Region region;
+            bool active;
+            int64_t start, children;
+            uint64_t counted[3];
+            Scope* parent;
+    };
+    // Prints the summary of every thread's timings, and writes the trace
+    void Summary();
+    void WriteTrace();
+};
+
+#endif /*Profiler_hpp*/
@@ -6,7 +6,124 @@ Copyright © 2019 Joe Raso, All rights reserved.
 
 #include "Protocol.hpp"
 
-void Protocol::KobAndersonReplication(double Temp, double relax, Stopwatch* timer){
+#include <cerrno>
+#include <chrono>
+#include <sys/stat.h>
+
+void Protocol::Configure(Particles* System, Options* options){
+    /* Applies the command line options to the particle system. */
+    if(options->cutoff > 0){
+        std::cout << "Cutoff = " << options->cutoff << " sigma" << std::endl;
+        System->SetCutoff(options->cutoff);
+        if(System->UsingCells()){
+            std::cout << "Using cell list" << std::endl;
+        }
+    }
+    if(options->skin > 0){
+        std::cout << "Neighbor list skin = " << options->skin << std::endl;
+        System->SetSkin(options->skin);
+    }
+    if(options->grbins > 0){System->SetHistogram(options->grbins);}
+    if(options->reorder > 0){
+        std::cout << "Reordering the particles every " << options->reorder
+                  << " steps" << std::endl;
+        System->SetReorder(options->reorder);
+    }
+    if(options->potential != "analytic"){
+        std::cout << "Tabulated pair potential = " << options->potential
+                  << std::endl;
+        System->SetPotential(options->potential, options->tablebins);
+        if(!System->CheckTables(1e-6)){
+            std::cout << "Error: pair tables too far off!" << std::endl;
+            exit(1);
+        }
+    }
+    System->SetKernel(options->kernel);
+    System->SetPrecision(options->precision);
+    std::cout << "Pair kernel = " << System->KernelName() << " ("
+              << System->Precision() << " precision)" << std::endl;
+    // single precision pair math agrees with double to about 1e-6
+    bool mixed = (options->precision == "mixed");
+    if((System->KernelName() != "scalar" || mixed)
+       && !System->CheckKernel(mixed ? 1e-4 : 1e-10)){
+        std::cout << "Error: pair kernel disagrees with scalar!" << std::endl;
+        exit(1);
+    }
+    return;
+}
+
+void Protocol::Configure(Integrator* Simulation, Options* options){
+    /* Applies the command line options to the integrator. */
+    Simulation->SetDirectory(options->directory);
+    Simulation->SetTrajectory(options->trajformat, options->trajfields,
+                              options->trajbuffers);
+    if(options->corrstride > 0){
+        Simulation->SetCorrelators(options->corrstride, options->corrpoints);
+    }
+    if(options->checkpoint){Simulation->SetCheckpoint(options->checkpoint);}
+    return;
+}
+
+Glass* Protocol::KobAnderson(double rho, double Temp, Options* options){
+    /* Makes the Kob-Anderson glass with the number of particles along a side
+    given in the options, or with more than one MPI process, the DomainGlass
+    split between them (see Domain.hpp). */
+    int nside = options->nside;
+#ifdef GLASSIUS_MPI
+    int processes;
+    MPI_Comm_size(MPI_COMM_WORLD, &processes);
+    if(processes > 1){
+        std::cout << "Splitting the box into " << processes << " slabs"
+                  << std::endl;
+        return new DomainGlass(rho, Temp, nside, options->cutoff,
+                               options->skin);
+    }
+#endif
+    return new Glass(rho, Temp, nside);
+}
+
+Integrator* Protocol::Newtonian(Particles* System, double Temp, double dt,
+                                int record, Options* options){
+    /* Makes velocity Verlet with timestep dt, or with r-RESPA on, RESPA with
+    the given number of inner steps of dt each. The outer step is then that
+    many times longer, so the recording interval (a multiple of it) is cut
+    down to match. Verlet on the glass is the templated VerletT<GlassPotential>
+    unless switched off in the options. */
+    int k = options->respa;
+    Glass* glass = dynamic_cast<Glass*>(System);
+#ifdef GLASSIUS_MPI
+    // (a split glass has to go through its own UpdateForces)
+    if(dynamic_cast<DomainGlass*>(System)){glass = 0;}
+#endif
+    if(k <= 1 && glass && options->templated){
+        return new VerletT<GlassPotential>(glass, Temp, dt, record);
+    }
+    if(k <= 1){return new Verlet(System, Temp, dt, record);}
+    std::cout << "r-RESPA: " << k << " inner steps, switching over "
+              << options->respasplit << " to "
+              << options->respasplit + options->respawidth << std::endl;
+    return new RESPA(System, Temp, k*dt, k, options->respasplit,
+                     options->respawidth, record/k);
+}
+
+Integrator* Protocol::Overdamped(Particles* System, double Temp, double dt,
+                                 int record, Options* options){
+    /* Makes the overdamped integrator named in the options: Brownian's Heun
+    scheme ("heun") or the single evaluation EulerMaruyama ("euler"). */
+    std::cout << "Overdamped scheme = " << options->overdamped << std::endl;
+    if(options->overdamped == "heun"){
+        return new Brownian(System, Temp, 1.0, dt, record);
+    }
+    if(options->overdamped == "euler"){
+        return new EulerMaruyama(System, Temp, 1.0, dt, record);
+    }
+    std::cout << "Error: unknown overdamped scheme " << options->overdamped
+              << "!" << std::endl;
+    exit(1);
+}
+
+void Protocol::KobAndersonReplication(double Temp, double relax, Stopwatch* timer,
+                                      Options* options){
     /* Replication run of the 1995 Kob-Anderson paper. */
     
     std::cout <<"\n"<< "Replication of Kob-Anderson Glass" <<"\n"<< std::endl;
@@ -21,10 +138,12 @@ void Protocol::KobAndersonReplication(double Temp, double relax, Stopwatch* time
     
     std::cout << "\n" << "Setting up System..." << std::endl;
     Glass System(rho, 5.0, 10);
+    Configure(&System, options);
     timer->StampComplete();
     
     std::cout << "\n" << "Setting up Simulation..." << std::endl;
     Verlet Simulation(&System, 5, 0.01, 10);
+    Configure(&Simulation, options);
     timer->StampComplete();
     
     
@@ -63,7 +182,7 @@ void Protocol::KobAndersonReplication(double Temp, double relax, Stopwatch* time
 }
 
 void Protocol::KobAndersonTest(double Temp, double relax, int record,
-                               Stopwatch* timer){
+                               Stopwatch* timer, Options* options){
     /* Set to mimick the tests run in LAMMPS */
 
     std::cout <<"\n"<< "Testing Kob-Anderson Glass" <<"\n"<< std::endl;
@@ -74,53 +193,62 @@ void Protocol::KobAndersonTest(double Temp, double relax, int record,
     double rho = 1000 / (9.4*9.4*9.4);
     
     std::cout << "Density = " << rho << std::endl;
-    std::cout << "Boxlength = 9.4" << std::endl;
+    std::cout << "Boxlength = " << 0.94*options->nside << std::endl;
     
     std::cout << "\n" << "Setting up System..." << std::endl;
-    Glass System(rho, 5.0, 10);
+    std::unique_ptr<Glass> glass(KobAnderson(rho, 5.0, options));
+    Glass& System = *glass;
+    Configure(&System, options);
     timer->StampComplete();
     
     std::cout << "\n" << "Setting up Simulation..." << std::endl;
-    Verlet verlet(&System, 5.0, 0.005, record);
-    verlet.SetEnergyFile("Data/Equilibration.csv");
+    std::unique_ptr<Integrator> verlet(Newtonian(&System, 5.0, 0.005, record,
+                                                 options));
+    Configure(verlet.get(), options);
+    verlet->SetEnergyFile(options->directory + "Equilibration.csv");
+    // thermostating every t = 2.5 (500 Verlet steps)
+    int every = std::max(1, int(2.5/verlet->Getdt() + 0.5));
     timer->StampComplete();
     
     std::cout << "\n" << "Mixing at T = 5.0" << std::endl;
     std::cout << "Running for t = 20" << std::endl;
-    std::cout << "Timestep = " << verlet.Getdt() << std::endl;
-    std::cout << "Steps = 4000" << std::endl;
-    std::cout << "Recording every = " << verlet.GetRecord() << std::endl;
-    std::cout << "Thermostating every 500 timesteps" << std::endl;
-    verlet.Equilibrate(20, 500);
+    std::cout << "Timestep = " << verlet->Getdt() << std::endl;
+    std::cout << "Steps = " << 20/verlet->Getdt() << std::endl;
+    std::cout << "Recording every = " << verlet->GetRecord() << std::endl;
+    std::cout << "Thermostating every " << every << " timesteps" << std::endl;
+    verlet->Equilibrate(20, every);
     timer->StampComplete();
  
     std::cout << "\n" << "Equilibrating at T = " << Temp << std::endl;
     std::cout << "Running for t = " << relax << std::endl;
-    std::cout << "Timestep = " << verlet.Getdt() << std::endl;
-    std::cout << "Steps = " << relax/verlet.Getdt() << std::endl;
-    std::cout << "Recording every = " << verlet.GetRecord() << std::endl;
-    std::cout << "Thermostating every 500 timesteps" << std::endl;
-    verlet.SetTemp(0.5);
+    std::cout << "Timestep = " << verlet->Getdt() << std::endl;
+    std::cout << "Steps = " << relax/verlet->Getdt() << std::endl;
+    std::cout << "Recording every = " << verlet->GetRecord() << std::endl;
+    std::cout << "Thermostating every " << every << " timesteps" << std::endl;
+    verlet->SetTemp(0.5);
     System.Thermalize(0.5);
-    verlet.Equilibrate(relax, 500);
+    verlet->Equilibrate(relax, every);
     timer->StampComplete();
  
     std::cout << "\n" << "Begining Production Run" << std::endl;
     std::cout << "Running for t = " << 1.5*relax << std::endl;
-    std::cout << "Timestep = " << verlet.Getdt() << std::endl;
-    std::cout << "Steps = " << (1.5*relax)/verlet.Getdt() << std::endl;
-    std::cout << "Recording every = " << verlet.GetRecord() << std::endl;
-    verlet.SetTime(0);
-    verlet.SetEnergyFile("Data/Energies.csv");
-    verlet.RecordTrajectory(true);
-    verlet.Run(1.5*relax);
+    std::cout << "Timestep = " << verlet->Getdt() << std::endl;
+    std::cout << "Steps = " << (1.5*relax)/verlet->Getdt() << std::endl;
+    std::cout << "Recording every = " << verlet->GetRecord() << std::endl;
+    verlet->SetTime(0);
+    verlet->SetEnergyFile(options->directory + "Energies.csv");
+    verlet->RecordTrajectory(true);
+    verlet->RecordCorrelators(true);
+    verlet->RecordPairs(true);
+    verlet->Run(1.5*relax);
     timer->StampComplete();
+    System.NeighborStats();
     
     return;
 }
 
 void Protocol::SzamelTest(double Temp, double relax, int record,
-                               Stopwatch* timer){
+                               Stopwatch* timer, Options* options){
 
     std::cout <<"\n"<< "Testing Szamel Brownian Glass" <<"\n"<< std::endl;
     std::cout << "Using Parameters:" << std::endl;
@@ -130,15 +258,18 @@ void Protocol::SzamelTest(double Temp, double relax, int record,
     double rho = 1000 / (9.4*9.4*9.4);
     
     std::cout << "Density = " << rho << std::endl;
-    std::cout << "Boxlength = 9.4" << std::endl;
+    std::cout << "Boxlength = " << 0.94*options->nside << std::endl;
     
     std::cout << "\n" << "Setting up System..." << std::endl;
-    Glass System(rho, 5.0, 10);
+    std::unique_ptr<Glass> glass(KobAnderson(rho, 5.0, options));
+    Glass& System = *glass;
+    Configure(&System, options);
     timer->StampComplete();
     
     std::cout << "\n" << "Setting up Simulation..." << std::endl;
     Verlet verlet(&System, 5.0, 0.005, record);
-    verlet.SetEnergyFile("Data/Equilibration.csv");
+    Configure(&verlet, options);
+    verlet.SetEnergyFile(options->directory + "Equilibration.csv");
     timer->StampComplete();
 
     std::cout << "\n" << "Mixing at T = 5.0" << std::endl;
@@ -150,33 +281,39 @@ void Protocol::SzamelTest(double Temp, double relax, int record,
     verlet.Equilibrate(20, 500);
     timer->StampComplete();
 
-    Brownian brownian(&System, Temp, 1.0, 0.00005, record);
-    brownian.SetEnergyFile("Data/Equilibration.csv");
+    std::unique_ptr<Integrator> brownian(Overdamped(&System, Temp, 0.00005,
+                                                    record, options));
+    Configure(brownian.get(), options);
+    brownian->SetEnergyFile(options->directory + "Equilibration.csv");
 
     std::cout << "\n" << "Equilibrating at T = " << Temp << std::endl;
     std::cout << "Running for t = " << relax << std::endl;
-    std::cout << "Timestep = " << brownian.Getdt() << std::endl;
-    std::cout << "Steps = " << relax/brownian.Getdt() << std::endl;
-    std::cout << "Recording every = " << brownian.GetRecord() << std::endl;
-    brownian.Run(relax);
+    std::cout << "Timestep = " << brownian->Getdt() << std::endl;
+    std::cout << "Steps = " << relax/brownian->Getdt() << std::endl;
+    std::cout << "Recording every = " << brownian->GetRecord() << std::endl;
+    brownian->Run(relax);
     timer->StampComplete();
  
     std::cout << "\n" << "Begining Production Run" << std::endl;
     std::cout << "Running for t = " << 1.5*relax << std::endl;
-    std::cout << "Timestep = " << brownian.Getdt() << std::endl;
-    std::cout << "Steps = " << (1.5*relax)/brownian.Getdt() << std::endl;
-    std::cout << "Recording every = " << brownian.GetRecord() << std::endl;
-    brownian.SetTime(0);
-    brownian.SetEnergyFile("Data/Energies.csv");
-    brownian.RecordTrajectory(true);
-    brownian.Run(1.5*relax);
+    std::cout << "Timestep = " << brownian->Getdt() << std::endl;
+    std::cout << "Steps = " << (1.5*relax)/brownian->Getdt() << std::endl;
+    std::cout << "Recording every = " << brownian->GetRecord() << std::endl;
+    brownian->SetTime(0);
+    brownian->SetEnergyFile(options->directory + "Energies.csv");
+    brownian->RecordTrajectory(true);
+    brownian->RecordCorrelators(true);
+    brownian->RecordPairs(true);
+    brownian->Run(1.5*relax);
     timer->StampComplete();
+    System.NeighborStats();
     
     return;
 }
 
 
-void Protocol::LennardJonesTest(double Temp, double relax, Stopwatch* timer){
+void Protocol::LennardJonesTest(double Temp, double relax, Stopwatch* timer,
+                                Options* options){
 
     std::cout <<"\n"<< "Testing Lennard-Jones Fluid" <<"\n"<< std::endl;
     std::cout << "Using Parameters:" << std::endl;
@@ -187,10 +324,12 @@ void Protocol::LennardJonesTest(double Temp, double relax, Stopwatch* timer){
     
     std::cout << "\n" << "Setting up System..." << std::endl;
     Fluid System(rho, Temp, 10);
+    Configure(&System, options);
     timer->StampComplete();
     
     std::cout << "\n" << "Setting up Simulation..." << std::endl;
     Verlet Simulation(&System, Temp, 0.01, 1);
+    Configure(&Simulation, options);
     timer->StampComplete();
     
     std::cout << "\n" << "Equilibrating at T = " << Temp << std::endl;
@@ -213,7 +352,8 @@ void Protocol::LennardJonesTest(double Temp, double relax, Stopwatch* timer){
     return;
 }
 
-void Protocol::DiffusionTest(double Temp, double relax, Stopwatch* timer){
+void Protocol::DiffusionTest(double Temp, double relax, Stopwatch* timer,
+                             Options* options){
 
     std::cout <<"\n"<< "Diffusion Testing Brownian Integrator" <<"\n"<< std::endl;
     
@@ -226,6 +366,7 @@ void Protocol::DiffusionTest(double Temp, double relax, Stopwatch* timer){
     
     std::cout << "\n" << "Setting up Simulation..." << std::endl;
     Brownian Simulation(&System, 1.0, 1.0, 0.00005, 1);
+    Configure(&Simulation, options);
     timer->StampComplete();
     
     std::cout << "\n" << "Begining Production Run" << std::endl;
@@ -243,3 +384,549 @@ void Protocol::DiffusionTest(double Temp, double relax, Stopwatch* timer){
     
     return;
 }
+
+namespace {
+
+void Average(const std::vector<std::string>& dirs, std::string name,
+             std::string output, int weight){
+    /* Averages the comma delimited file "name" over the replica directories,
+    line by line and column by column; the first column (the time) is taken
+    as it is. If weight > 0, that column holds the number of samples behind
+    each line: the average is weighted by it, and it is summed instead.
+    Lines past the end of the shortest file are left out. */
+    std::vector<std::vector<std::vector<double> > > tables;
+    size_t lines = 0, l, c, m;
+    for(m=0;m<dirs.size();m++){
+        std::ifstream in(dirs[m] + name);
+        if(!in.is_open()){return;}
+        std::vector<std::vector<double> > table;
+        std::string line, entry;
+        while(std::getline(in, line)){
+            std::vector<double> row;
+            size_t start = 0, comma;
+            do {
+                comma = line.find(',', start);
+                row.push_back(std::stod(line.substr(start, comma - start)));
+                start = comma + 1;
+            } while(comma != std::string::npos);
+            table.push_back(row);
+        }
+        lines = (m == 0) ? table.size() : std::min(lines, table.size());
+        tables.push_back(table);
+    }
+    std::ofstream out(output);
+    // File check-stop
+    if(!out.is_open()){
+        std::cout << "Error opening ensemble file " << output << "!"
+                  << std::endl;
+        exit(1);
+    }
+    out.precision(10);
+    for(l=0;l<lines;l++){
+        size_t columns = tables[0][l].size();
+        out << tables[0][l][0];
+        for(c=1;c<columns;c++){
+            double sum = 0, total = 0;
+            for(m=0;m<tables.size();m++){
+                double w = (weight > 0) ? tables[m][l][weight] : 1;
+                sum += (int(c) == weight) ? w : w*tables[m][l][c];
+                total += w;
+            }
+            out << ", " << ((int(c) == weight || total == 0) ? sum
+                                                             : sum/total);
+        }
+        out << std::endl;
+    }
+    return;
+}
+
+bool Relaxation(std::string name, double& tau, double& last){
+    /* Reads a correlator file (see Correlator.hpp) for the time at which
+    Fs(k,t) first drops below 1/e, interpolating between the lags around it,
+    and the value of Fs(k,t) at the longest lag. Returns false if Fs(k,t)
+    never gets below 1/e. */
+    std::ifstream in(name);
+    std::string line;
+    double t0 = 0, f0 = 1, t, fs;
+    bool found = false;
+    last = 1;
+    while(std::getline(in, line)){
+        size_t a = line.find(','), b = line.find(',', a+1);
+        t = std::stod(line.substr(0, a));
+        fs = std::stod(line.substr(b+1));
+        if(!found && fs < exp(-1.0)){
+            tau = t0 + (t - t0)*(f0 - exp(-1.0))/(f0 - fs);
+            found = true;
+        }
+        t0 = t; f0 = fs; last = fs;
+    }
+    return found;
+}
+
+}
+
+void Protocol::Ensemble(int mode, int replicas, double Temp, double relax,
+                        int record, int seed, bool average, Stopwatch* timer,
+                        Options* options){
+    /* Runs the KA (mode 0) or Szamel (mode 1) test for each of the replicas,
+    handed out over the thread pool; each replica's force loop runs on its
+    own thread. Replica m draws from stream m+1 of the seed, and writes its
+    files into replica<m>/ under the data directory. If asked, the energies
+    and correlators are averaged over the ensemble afterwards, into
+    EnsembleEnergies.csv and EnsembleCorrelators.csv. */
+    
+    std::cout <<"\n"<< "Running an ensemble of " << replicas << " replicas"
+              << " on " << Pool::Size() << " threads" << std::endl;
+    std::vector<std::string> dirs(replicas);
+    for(int m=0;m<replicas;m++){
+        dirs[m] = options->directory + "replica" + std::to_string(m) + "/";
+        // Directory check-stop (before any replica starts)
+        if(mkdir(dirs[m].c_str(), 0755) != 0 && errno != EEXIST){
+            std::cout << "Error: can't make the directory " << dirs[m]
+                      << std::endl;
+            exit(1);
+        }
+    }
+    
+    Pool::Tasks(replicas, [&](int m){
+        chaos::State stream;
+        chaos::use(&stream);
+        chaos::seed(seed, m+1);
+        Options mine = *options;
+        mine.directory = dirs[m];
+        Stopwatch clock;
+        if (mode==0) {KobAndersonTest(Temp, relax, record, &clock, &mine);};
+        if (mode==1) {SzamelTest(Temp, relax, record, &clock, &mine);};
+        chaos::use(0);
+    });
+    timer->StampComplete();
+    
+    if (average) {
+        std::cout << "\n" << "Averaging over the ensemble" << std::endl;
+        Average(dirs, "Energies.csv", options->directory
+                + "EnsembleEnergies.csv", 0);
+        Average(dirs, "Correlators.csv", options->directory
+                + "EnsembleCorrelators.csv", 4);
+    }
+    return;
+}
+
+void Protocol::BatchTest(int replicas, double Temp, double relax, int record,
+                         int seed, Stopwatch* timer, Options* options){
+    /* The KA test for a batch of replicas stored side by side and advanced
+    together (see Batch.hpp). Replica l starts from stream l+1 of the seed,
+    like replica l of an Ensemble; the energies and correlators written are
+    averages over the batch. */
+    
+    std::cout <<"\n"<< "Testing a batch of " << replicas
+              << " Kob-Anderson Glasses" <<"\n"<< std::endl;
+    std::cout << "Using Parameters:" << std::endl;
+    std::cout << "RelaxationTime =  " << relax << std::endl;
+    
+    double rho = 1000 / (9.4*9.4*9.4);
+    
+    std::cout << "Density = " << rho << std::endl;
+    std::cout << "Boxlength = " << 0.94*options->nside << std::endl;
+    
+    std::cout << "\n" << "Setting up System..." << std::endl;
+    GlassBatch System(rho, 5.0, options->nside, replicas, seed);
+    if(options->cutoff > 0){
+        std::cout << "Cutoff = " << options->cutoff << " sigma" << std::endl;
+        System.SetCutoff(options->cutoff);
+    }
+    timer->StampComplete();
+    
+    std::cout << "\n" << "Setting up Simulation..." << std::endl;
+    VerletBatch verlet(&System, 5.0, 0.005, record);
+    verlet.SetDirectory(options->directory);
+    if(options->corrstride > 0){
+        verlet.SetCorrelators(options->corrstride, options->corrpoints);
+    }
+    verlet.SetEnergyFile(options->directory + "Equilibration.csv");
+    // thermostating every t = 2.5 (500 Verlet steps)
+    int every = std::max(1, int(2.5/verlet.Getdt() + 0.5));
+    timer->StampComplete();
+    
+    std::cout << "\n" << "Mixing at T = 5.0" << std::endl;
+    std::cout << "Running for t = 20" << std::endl;
+    std::cout << "Timestep = " << verlet.Getdt() << std::endl;
+    std::cout << "Steps = " << 20/verlet.Getdt() << std::endl;
+    std::cout << "Recording every = " << verlet.GetRecord() << std::endl;
+    std::cout << "Thermostating every " << every << " timesteps" << std::endl;
+    verlet.Equilibrate(20, every);
+    timer->StampComplete();
+ 
+    std::cout << "\n" << "Equilibrating at T = " << Temp << std::endl;
+    std::cout << "Running for t = " << relax << std::endl;
+    std::cout << "Timestep = " << verlet.Getdt() << std::endl;
+    std::cout << "Steps = " << relax/verlet.Getdt() << std::endl;
+    std::cout << "Recording every = " << verlet.GetRecord() << std::endl;
+    std::cout << "Thermostating every " << every << " timesteps" << std::endl;
+    verlet.SetTemp(0.5);
+    System.Thermalize(0.5);
+    verlet.Equilibrate(relax, every);
+    timer->StampComplete();
+ 
+    std::cout << "\n" << "Begining Production Run" << std::endl;
+    std::cout << "Running for t = " << 1.5*relax << std::endl;
+    std::cout << "Timestep = " << verlet.Getdt() << std::endl;
+    std::cout << "Steps = " << (1.5*relax)/verlet.Getdt() << std::endl;
+    std::cout << "Recording every = " << verlet.GetRecord() << std::endl;
+    verlet.SetTime(0);
+    verlet.SetEnergyFile(options->directory + "Energies.csv");
+    verlet.RecordCorrelators(true);
+    verlet.Run(1.5*relax);
+    timer->StampComplete();
+    
+    return;
+}
+
+void Protocol::ParallelTempering(int replicas, double Temp, double relax,
+                                 int record, int seed, Stopwatch* timer,
+                                 Options* options){
+    /* Equilibrates the KA glass at T by parallel tempering (replica
+    exchange). The replicas are mixed at T = 5, put on a geometric ladder of
+    temperatures from T up to the top given in the options, and run side by
+    side over the thread pool, each with Verlet thermostated to its own
+    temperature. Every so many steps, neighboring temperatures try to swap
+    their replicas (the even pairs on one round, the odd ones on the next),
+    taking the swap with the Metropolis probability
+        min(1, exp[(1/T - 1/T')(U - U')]),
+    U and U' being the potential energies of the replicas at T and T'. The
+    velocities of a swapped replica are rescaled to its new temperature.
+    Replica m starts from stream m+1 of the seed and writes its energies into
+    replica<m>/; TemperingLadder.csv has the replica at each temperature after
+    every round, and TemperingAcceptance.csv the acceptance rate of each pair
+    of neighboring temperatures. The replica that ends up at T then gets the
+    production run of the KA test. */
+    
+    std::cout <<"\n"<< "Parallel tempering of the Kob-Anderson Glass" <<"\n"
+              << std::endl;
+    std::cout << "Using Parameters:" << std::endl;
+    std::cout << "RelaxationTime =  " << relax << std::endl;
+    
+    double rho = 1000 / (9.4*9.4*9.4);
+    int M = replicas, k = options->temperingswap, m, t;
+    std::vector<double> ladder(M);
+    std::cout << "Density = " << rho << std::endl;
+    std::cout << "Boxlength = " << 0.94*options->nside << std::endl;
+    std::cout << "Temperatures =";
+    for(t=0;t<M;t++){
+        ladder[t] = Temp*pow(options->temperingtop/Temp, double(t)/(M-1));
+        std::cout << " " << ladder[t];
+    }
+    std::cout << std::endl;
+    std::vector<std::string> dirs(M);
+    for(m=0;m<M;m++){
+        dirs[m] = options->directory + "replica" + std::to_string(m) + "/";
+        // Directory check-stop (before any replica starts)
+        if(mkdir(dirs[m].c_str(), 0755) != 0 && errno != EEXIST){
+            std::cout << "Error: can't make the directory " << dirs[m]
+                      << std::endl;
+            exit(1);
+        }
+    }
+    
+    std::cout << "\n" << "Setting up Systems..." << std::endl;
+    std::vector<std::unique_ptr<Glass> > glasses(M);
+    for(m=0;m<M;m++){
+        chaos::State stream;
+        chaos::use(&stream);
+        chaos::seed(seed, m+1);
+        glasses[m].reset(new Glass(rho, 5.0, options->nside));
+        chaos::use(0);
+        Configure(glasses[m].get(), options);
+    }
+    timer->StampComplete();
+    
+    std::cout << "\n" << "Setting up Simulations..." << std::endl;
+    std::vector<std::unique_ptr<Integrator> > sims(M);
+    Options mine = *options;
+    for(m=0;m<M;m++){
+        mine.directory = dirs[m];
+        sims[m].reset(Newtonian(glasses[m].get(), 5.0, 0.005, record, &mine));
+        Configure(sims[m].get(), &mine);
+        sims[m]->SetEnergyFile(dirs[m] + "Equilibration.csv");
+    }
+    double dt = sims[0]->Getdt();
+    // thermostating every t = 2.5 (500 Verlet steps)
+    int every = std::max(1, int(2.5/dt + 0.5));
+    timer->StampComplete();
+    
+    std::cout << "\n" << "Mixing at T = 5.0" << std::endl;
+    std::cout << "Running for t = 20" << std::endl;
+    std::cout << "Timestep = " << dt << std::endl;
+    std::cout << "Thermostating every " << every << " timesteps" << std::endl;
+    Pool::Tasks(M, [&](int m){sims[m]->Equilibrate(20, every);});
+    timer->StampComplete();
+    
+    int rounds = int(relax/(k*dt));
+    std::cout << "\n" << "Tempering down to T = " << Temp << std::endl;
+    std::cout << "Running for t = " << relax << std::endl;
+    std::cout << "Swapping every " << k << " timesteps (" << rounds
+              << " rounds)" << std::endl;
+    // at[t] is the replica at temperature t; each round is one recording
+    // cycle of k steps, thermostated at its end
+    std::vector<int> at(M);
+    std::vector<long> tried(M-1, 0), taken(M-1, 0);
+    for(t=0;t<M;t++){
+        at[t] = t;
+        sims[t]->SetTemp(ladder[t]);
+        sims[t]->SetRecord(k);
+        sims[t]->SetEnergyFile(dirs[t] + "Tempering.csv");
+        glasses[t]->Thermalize(ladder[t]);
+    }
+    std::ofstream ladderfile(options->directory + "TemperingLadder.csv");
+    // File check-stop
+    if(!ladderfile.is_open()){
+        std::cout << "Error opening tempering ladder file!" << std::endl;
+        exit(1);
+    }
+    for(int round=0;round<rounds;round++){
+        Pool::Tasks(M, [&](int t){
+            sims[at[t]]->Equilibrate((k + 0.5)*dt, k);
+        });
+        for(t=round%2;t+1<M;t+=2){
+            double delta = (1/ladder[t] - 1/ladder[t+1])
+                           *(glasses[at[t]]->PE() - glasses[at[t+1]]->PE());
+            tried[t]++;
+            if(delta < 0 && chaos::random() >= exp(delta)){continue;}
+            taken[t]++;
+            std::swap(at[t], at[t+1]);
+            for(int u=t;u<t+2;u++){
+                sims[at[u]]->SetTemp(ladder[u]);
+                glasses[at[u]]->Thermalize(ladder[u]);
+            }
+        }
+        ladderfile << sims[at[0]]->Time();
+        for(t=0;t<M;t++){ladderfile << ", " << at[t];}
+        ladderfile << std::endl;
+    }
+    ladderfile.close();
+    
+    std::ofstream out(options->directory + "TemperingAcceptance.csv");
+    // File check-stop
+    if(!out.is_open()){
+        std::cout << "Error opening tempering acceptance file!" << std::endl;
+        exit(1);
+    }
+    for(t=0;t+1<M;t++){
+        double rate = tried[t] > 0 ? double(taken[t])/tried[t] : 0;
+        out << ladder[t] << ", " << ladder[t+1] << ", " << tried[t] << ", "
+            << taken[t] << ", " << rate << std::endl;
+        std::cout << "Swap acceptance " << ladder[t] << " <-> "
+                  << ladder[t+1] << " = " << rate << std::endl;
+    }
+    timer->StampComplete();
+    
+    Glass& System = *glasses[at[0]];
+    Integrator* verlet = sims[at[0]].get();
+    std::cout << "\n" << "Begining Production Run (replica " << at[0] << ")"
+              << std::endl;
+    std::cout << "Running for t = " << 1.5*relax << std::endl;
+    std::cout << "Timestep = " << dt << std::endl;
+    std::cout << "Steps = " << (1.5*relax)/dt << std::endl;
+    Configure(verlet, options);
+    verlet->SetRecord(record);
+    std::cout << "Recording every = " << verlet->GetRecord() << std::endl;
+    verlet->SetTime(0);
+    verlet->SetEnergyFile(options->directory + "Energies.csv");
+    verlet->RecordTrajectory(true);
+    verlet->RecordCorrelators(true);
+    verlet->RecordPairs(true);
+    verlet->Run(1.5*relax);
+    timer->StampComplete();
+    System.NeighborStats();
+    
+    return;
+}
+
+void Protocol::MonteCarloTest(double Temp, double relax, int record,
+                              Stopwatch* timer, Options* options){
+    /* The KA test with Metropolis Monte Carlo in place of the dynamics: the
+    glass is mixed at T = 5 with Verlet, as in the KA test, then equilibrated
+    at T for relax sweeps, adapting the step to the acceptance rate given in
+    the options, and run for 1.5 relax sweeps with the step held fixed. Times
+    are in sweeps, and record is in sweeps too. */
+
+    std::cout <<"\n"<< "Monte Carlo of the Kob-Anderson Glass" <<"\n"
+              << std::endl;
+    std::cout << "Using Parameters:" << std::endl;
+    std::cout << "RelaxationTime =  " << relax << " sweeps" << std::endl;
+    
+    double rho = 1000 / (9.4*9.4*9.4);
+    
+    std::cout << "Density = " << rho << std::endl;
+    std::cout << "Boxlength = " << 0.94*options->nside << std::endl;
+    
+    std::cout << "\n" << "Setting up System..." << std::endl;
+    Glass System(rho, 5.0, options->nside);
+    Configure(&System, options);
+    timer->StampComplete();
+    
+    std::cout << "\n" << "Setting up Simulation..." << std::endl;
+    std::unique_ptr<Integrator> verlet(Newtonian(&System, 5.0, 0.005, record,
+                                                 options));
+    Configure(verlet.get(), options);
+    verlet->SetEnergyFile(options->directory + "Equilibration.csv");
+    // thermostating every t = 2.5 (500 Verlet steps)
+    int every = std::max(1, int(2.5/verlet->Getdt() + 0.5));
+    MonteCarlo mc(&System, Temp, 1.0, record, options->mcaccept);
+    Configure(&mc, options);
+    mc.SetEnergyFile(options->directory + "Equilibration.csv");
+    timer->StampComplete();
+    
+    std::cout << "\n" << "Mixing at T = 5.0" << std::endl;
+    std::cout << "Running for t = 20" << std::endl;
+    std::cout << "Timestep = " << verlet->Getdt() << std::endl;
+    std::cout << "Steps = " << 20/verlet->Getdt() << std::endl;
+    std::cout << "Recording every = " << verlet->GetRecord() << std::endl;
+    std::cout << "Thermostating every " << every << " timesteps" << std::endl;
+    verlet->Equilibrate(20, every);
+    timer->StampComplete();
+    
+    std::cout << "\n" << "Equilibrating at T = " << Temp << std::endl;
+    std::cout << "Running for " << relax << " sweeps" << std::endl;
+    std::cout << "Target acceptance = " << options->mcaccept << std::endl;
+    // (the sweeps leave the velocities alone; they only set the KE)
+    System.Thermalize(Temp);
+    mc.Equilibrate(relax, 1);
+    std::cout << "Acceptance = " << mc.Acceptance() << ", step = "
+              << mc.Step() << std::endl;
+    timer->StampComplete();
+    
+    std::cout << "\n" << "Begining Production Run" << std::endl;
+    std::cout << "Running for " << 1.5*relax << " sweeps" << std::endl;
+    std::cout << "Step = " << mc.Step() << std::endl;
+    std::cout << "Recording every = " << mc.GetRecord() << std::endl;
+    mc.Adapt(false);
+    mc.ResetAcceptance();
+    mc.SetTime(0);
+    mc.SetEnergyFile(options->directory + "Energies.csv");
+    mc.RecordTrajectory(true);
+    mc.RecordCorrelators(true);
+    mc.RecordPairs(true);
+    mc.Run(1.5*relax);
+    std::cout << "Acceptance = " << mc.Acceptance() << std::endl;
+    timer->StampComplete();
+    System.NeighborStats();
+    
+    return;
+}
+
+void Protocol::OverdampedValidation(double Temp, double relax, int record,
+                                    Stopwatch* timer, Options* options){
+    /* Runs the Heun (Brownian) and Euler-Maruyama schemes side by side, from
+    the same state and with the same noise. First on free particles, where
+    the MSD must come out as 6Tt; then on the KA glass, mixed at T = 5 and
+    run at T for t = relax, where the Fs(k,t) relaxation time of the two
+    should agree. The results, with the cost per step of each scheme, go to
+    OverdampedValidation.csv: scheme, MSD/6Tt of the free particles, the
+    relaxation time (0 if Fs(k,t) didn't reach 1/e), Fs(k,t) at the longest
+    lag, and the seconds per step on the glass. */
+    
+    std::cout <<"\n"<< "Validating the overdamped integrators" <<"\n"
+              << std::endl;
+    std::cout << "Temperature = " << Temp << std::endl;
+    std::cout << "Running for t = " << relax << std::endl;
+    
+    double rho = 1000 / (9.4*9.4*9.4);
+    double dt = 0.00005;
+    int steps = int(relax/dt);
+    const char* schemes[2] = {"heun", "euler"};
+    double ratio[2], tau[2], last[2], cost[2];
+    bool relaxed[2];
+    Options mine = *options;
+    mine.checkpoint = 0;
+    
+    std::cout << "\n" << "Free diffusion..." << std::endl;
+    chaos::State rng = chaos::save();
+    for(int s=0;s<2;s++){
+        chaos::restore(rng);
+        mine.overdamped = schemes[s];
+        Free System(rho, Temp, 10);
+        std::unique_ptr<Integrator> sim(Overdamped(&System, Temp, dt, record,
+                                                   &mine));
+        int N = System.Number();
+        Matrix start(3, N);
+        for(int k=0;k<3;k++){
+            for(int i=0;i<N;i++){start.Data()[k][i] = System.r[k][i];}
+        }
+        for(int n=0;n<steps;n++){sim->Propigate();}
+        double msd = 0;
+        for(int k=0;k<3;k++){
+            for(int i=0;i<N;i++){
+                double d = System.r[k][i] - start.Data()[k][i];
+                msd += d*d/N;
+            }
+        }
+        ratio[s] = msd/(6*Temp*steps*dt);
+        std::cout << schemes[s] << ": MSD/6Tt = " << ratio[s] << std::endl;
+    }
+    timer->StampComplete();
+    
+    std::cout << "\n" << "Mixing the KA glass at T = 5.0" << std::endl;
+    Glass System(rho, 5.0, 10);
+    Configure(&System, options);
+    Verlet verlet(&System, 5.0, 0.005, record);
+    Configure(&verlet, &mine);
+    verlet.SetEnergyFile(options->directory + "Equilibration.csv");
+    verlet.Equilibrate(20, 500);
+    int N = System.Number();
+    Matrix mixed(3, N);
+    for(int k=0;k<3;k++){
+        for(int i=0;i<N;i++){mixed.Data()[k][i] = System.r[k][i];}
+    }
+    rng = chaos::save();
+    timer->StampComplete();
+    
+    for(int s=0;s<2;s++){
+        std::cout << "\n" << "KA relaxation, " << schemes[s] << std::endl;
+        chaos::restore(rng);
+        for(int k=0;k<3;k++){
+            for(int i=0;i<N;i++){System.r[k][i] = mixed.Data()[k][i];}
+        }
+        System.setTime(0);
+        System.UpdateForces();
+        mine.overdamped = schemes[s];
+        std::unique_ptr<Integrator> sim(Overdamped(&System, Temp, dt, record,
+                                                   &mine));
+        Configure(sim.get(), &mine);
+        std::string prefix = options->directory + schemes[s];
+        sim->SetEnergyFile(prefix + "Energies.csv");
+        sim->SetCorrelators(record, options->corrpoints);
+        sim->SetCorrelatorFile(prefix + "Correlators.csv");
+        sim->RecordCorrelators(true);
+        auto begin = std::chrono::steady_clock::now();
+        sim->Run(relax);
+        cost[s] = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - begin).count()/steps;
+        tau[s] = 0;
+        relaxed[s] = Relaxation(prefix + "Correlators.csv", tau[s], last[s]);
+        std::cout << "Relaxation time = ";
+        if(relaxed[s]){std::cout << tau[s];} else {std::cout << "> " << relax;}
+        std::cout << ", Fs(k," << relax << ") = " << last[s] << std::endl;
+        std::cout << "Seconds per step = " << cost[s] << std::endl;
+        timer->StampComplete();
+    }
+    
+    std::ofstream out(options->directory + "OverdampedValidation.csv");
+    // File check-stop
+    if(!out.is_open()){
+        std::cout << "Error opening validation file!" << std::endl;
+        exit(1);
+    }
+    for(int s=0;s<2;s++){
+        out << schemes[s] << ", " << ratio[s] << ", " << tau[s] << ", "
+            << last[s] << ", " << cost[s] << std::endl;
+    }
+    std::cout << "\n" << "Euler-Maruyama vs Heun: MSD/6Tt " << ratio[1]
+              << " vs " << ratio[0] << ", Fs(k," << relax << ") " << last[1]
+              << " vs " << last[0];
+    if(relaxed[0] && relaxed[1]){
+        std::cout << ", relaxation time " << tau[1] << " vs " << tau[0]
+                  << " (" << 100*(tau[1] - tau[0])/tau[0] << "%)";
+    }
+    std::cout << ", " << cost[0]/cost[1] << "x faster per step" << std::endl;
+    return;
+}
@@ -12,23 +12,90 @@ invoked in main.cpp
 #define Protocol_hpp
 
 #include <fstream>
+#include <memory>
 #include <iostream>
+#include <string>
+#include <vector>
 #include "Stopwatch.hpp"
+#include "Batch.hpp"
 #include "Particles.hpp"
 #include "Integration.hpp"
+#include "Pool.hpp"
+#include "chaos.hpp"
+#ifdef GLASSIUS_MPI
+#include "Domain.hpp"
+#endif
 
 
+// The default precision of the pair math, set at build time with "make
+// PRECISION=mixed"
+#ifndef GLASSIUS_PRECISION
+#define GLASSIUS_PRECISION "double"
+#endif
+
 namespace Protocol {
+    // Optional settings, taken from the command line flags in main.cpp
+    struct Options {
+        double cutoff = 0; // LJ cutoff in units of sigma (0 = no cutoff)
+        double skin = 0;   // neighbor list skin (0 = no neighbor list)
+        int threads = 1;   // size of the thread pool
+        int reorder = 0;   // steps between Morton reorderings (0 = off)
+        int nside = 10;    // KA/Szamel tests: particles along a box side
+        std::string kernel = "auto"; // pair kernel: auto/scalar/avx2/avx512
+        std::string precision = GLASSIUS_PRECISION; // pair math: double/mixed
+        std::string trajformat = "f64"; // trajectory format: f64/f32/csv
+        std::string trajfields = "rvf"; // trajectory fields: some of r,v,f
+        int trajbuffers = 4; // frames queued for the writer thread (0: none)
+        int corrstride = 0; // steps between correlator samples (0 = off)
+        int corrpoints = 16; // correlator samples per level
+        int grbins = 0; // pair distance histogram bins (0 = off)
+        std::string potential = "analytic"; // or tabulated: lj/wca/harmonic/ipl
+        int tablebins = 4096; // spline bins per species pair when tabulated
+        std::string overdamped = "heun"; // overdamped scheme: heun/euler
+        int respa = 0; // r-RESPA inner steps per outer step (0 = Verlet)
+        double respasplit = 1.7; // start of the r-RESPA switching shell
+        double respawidth = 0.3; // width of the r-RESPA switching shell
+        bool templated = true; // compile-time dispatched Verlet (VerletT)
+        double temperingtop = 1.0; // parallel tempering: top of the ladder
+        int temperingswap = 100; // parallel tempering: steps between swaps
+        double mcaccept = 0.5; // Monte Carlo: target acceptance rate
+        Checkpoint* checkpoint = 0; // checkpointing/resuming (0 = off)
+        std::string directory = "Data/"; // where the output files go
+    };
+    // Applies the options to a freshly built particle system or integrator
+    void Configure(Particles*, Options*);
+    void Configure(Integrator*, Options*);
+    // The KA glass, split over the MPI processes when there are several
+    // (the caller owns it)
+    Glass* KobAnderson(double, double, Options*);
+    // The Newtonian and overdamped integrators chosen in the options (the
+    // caller owns them)
+    Integrator* Newtonian(Particles*, double, double, int, Options*);
+    Integrator* Overdamped(Particles*, double, double, int, Options*);
     // Replication of the Kob-Anderson paper 
-    void KobAndersonReplication(double, double, Stopwatch*);
+    void KobAndersonReplication(double, double, Stopwatch*, Options*);
     // KA Testing:matching lammps tests
-    void KobAndersonTest(double, double, int, Stopwatch*);
+    void KobAndersonTest(double, double, int, Stopwatch*, Options*);
     // Szamel Testing: matching lammps tests
-    void SzamelTest(double, double, int, Stopwatch*);
+    void SzamelTest(double, double, int, Stopwatch*, Options*);
     // LJ Testing mixing equilibration etc.
-    void LennardJonesTest(double, double, Stopwatch*);
+    void LennardJonesTest(double, double, Stopwatch*, Options*);
     // Diffusion testing for the ODB integrator.
-    void DiffusionTest(double, double, Stopwatch*);
+    void DiffusionTest(double, double, Stopwatch*, Options*);
+    // Checks the Euler-Maruyama scheme against Heun on free diffusion and
+    // on the relaxation of the KA glass
+    void OverdampedValidation(double, double, int, Stopwatch*, Options*);
+    // Many replicas of the KA (0) or Szamel (1) test in one process
+    void Ensemble(int, int, double, double, int, int, bool, Stopwatch*,
+                  Options*);
+    // The KA test for a batch of replicas integrated in lockstep
+    void BatchTest(int, double, double, int, int, Stopwatch*, Options*);
+    // The KA test with Metropolis Monte Carlo sweeps for the dynamics
+    void MonteCarloTest(double, double, int, Stopwatch*, Options*);
+    // Parallel tempering of KA replicas on a temperature ladder, swapping
+    // between neighboring temperatures (replica exchange)
+    void ParallelTempering(int, double, double, int, int, Stopwatch*,
+                           Options*);
 }
 
 #endif /*Protocol_hpp*/
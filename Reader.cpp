@@ -0,0 +1,116 @@
+/*
+Glassy Dynamics Simulation Module: Reader
+Created by Joe Raso, Sat Oct 17 20:50:35 UTC 2026
+Copyright © 2019 Joe Raso, All rights reserved.
+*/
+
+#include "Reader.hpp"
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool Reader::Open(std::string path){
+    /* Maps the trajectory file into memory and reads its header. Returns
+    false if the file can't be opened or isn't a trajectory. */
+    Close();
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0){
+        std::cout << "Error opening trajectory file " << path << "!"
+                  << std::endl;
+        return false;
+    }
+    struct stat info;
+    fstat(fd, &info);
+    size = info.st_size;
+    if(size < 36){
+        std::cout << "Error: " << path << " is not a trajectory file!"
+                  << std::endl;
+        close(fd); size = 0;
+        return false;
+    }
+    void* m = mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(m == MAP_FAILED){
+        std::cout << "Error mapping trajectory file " << path << "!"
+                  << std::endl;
+        size = 0;
+        return false;
+    }
+    map = static_cast<const char*>(m);
+    if(std::memcmp(map, "GLSTRAJ1", 8) != 0){
+        std::cout << "Error: " << path << " is not a trajectory file!"
+                  << std::endl;
+        Close();
+        return false;
+    }
+
+    // Header: N, precision, fields, box length, dt, species
+    int32_t head[3];
+    double box[2];
+    std::memcpy(head, map+8, sizeof(head));
+    std::memcpy(box, map+20, sizeof(box));
+    N = head[0]; bytes = head[1]; fields = head[2];
+    L = box[0]; dt = box[1];
+    species = reinterpret_cast<const int32_t*>(map+36);
+    header = 36 + sizeof(int32_t)*N;
+
+    // Every frame is the time plus 3N values per field
+    int nfields = 0;
+    for(int q=0;q<3;q++){if(fields & (1<<q)){nfields++;}}
+    framesize = sizeof(double) + size_t(nfields)*3*N*bytes;
+    frames = (size > header) ? int((size - header)/framesize) : 0;
+    return true;
+}
+
+void Reader::Close(){
+    if(map != 0){munmap(const_cast<char*>(map), size);}
+    map = 0; size = 0; frames = 0;
+    return;
+}
+
+double Reader::Time(int frame){
+    /* Simulation time of the frame. */
+    double t;
+    std::memcpy(&t, map + header + frame*framesize, sizeof(double));
+    return t;
+}
+
+const char* Reader::Field(int frame, int field){
+    /* Start of the given field within the frame. */
+    const char* p = map + header + frame*framesize + sizeof(double);
+    for(int q=0;q<3;q++){
+        if((1<<q) == field){return p;}
+        if(fields & (1<<q)){p += size_t(3)*N*bytes;}
+    }
+    return 0;
+}
+
+void Reader::Get(int frame, int field, double** out){
+    /* Copies one field of a frame into a (3 x N) array, out[k][i] being
+    component k of particle i. */
+    const char* p = Field(frame, field);
+    for(int k=0;k<3;k++){
+        if(bytes == 4){
+            const float* x = reinterpret_cast<const float*>(p) + k*N;
+            for(int i=0;i<N;i++){out[k][i] = x[i];}
+        } else {
+            std::memcpy(out[k], p + size_t(k)*N*sizeof(double),
+                        sizeof(double)*N);
+        }
+    }
+    return;
+}
+
+int Reader::Find(double t){
+    /* Index of the first frame at or after time t (frames are in order of
+    time), or Frames() if there is none. */
+    int lo = 0, hi = frames, mid;
+    while(lo < hi){
+        mid = (lo + hi)/2;
+        if(Time(mid) < t){lo = mid + 1;} else {hi = mid;}
+    }
+    return lo;
+}
@@ -0,0 +1,59 @@
+/*
+Glassy Dynamics Simulation Module: Reader
+Created by Joe Raso, Sat Oct 17 20:50:35 UTC 2026
+Copyright © 2019 Joe Raso, All rights reserved.
+
+This module contains the trajectory reader for the binary traj.bin files
+written by the Trajectory module (see Trajectory.hpp for the layout). The file
+is memory-mapped rather than read in, so opening it costs nothing, and since
+every frame has the same size any frame can be reached directly from its
+index. Frames are only paged in from disk when they are used. A partly
+written last frame (from a run still in progress) is ignored.
+
+It has no dependence on the rest of the simulation, so the analysis tools can
+be built from it alone.
+*/
+
+#ifndef Reader_hpp
+#define Reader_hpp
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+// Field flags, as in the trajectory header
+#define READ_POSITIONS 1
+#define READ_VELOCITIES 2
+#define READ_FORCES 4
+
+class Reader{
+    /* Random access to the frames of a binary trajectory file */
+    public:
+        // Constructor
+        Reader(): map(0), size(0), N(0), bytes(0), fields(0), frames(0),
+            L(0), dt(0) {};
+        ~Reader(){Close();};
+        bool Open(std::string path);
+        void Close();
+        // Header information
+        inline int Number(){return N;};
+        inline int Frames(){return frames;};
+        inline double Length(){return L;};
+        inline double Timestep(){return dt;};
+        inline int Precision(){return bytes;};
+        inline bool Has(int field){return (fields & field) != 0;};
+        inline const int32_t* Species(){return species;};
+        // Frame access
+        double Time(int frame);
+        void Get(int frame, int field, double** out);
+        int Find(double t);
+    protected:
+        const char* Field(int frame, int field);
+        const char* map;
+        size_t size, header, framesize;
+        int N, bytes, fields, frames;
+        double L, dt;
+        const int32_t* species;
+};
+
+#endif /*Reader_hpp*/
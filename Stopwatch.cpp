@@ -7,33 +7,36 @@ Copyright © 2019 Joe Raso, All rights reserved.
 #include "Stopwatch.hpp"
 
 Stopwatch::Stopwatch(){
-    tici = std::time(0);
-    ticf = std::time(0);
-    ticlast = std::time(0);
+    start = std::chrono::steady_clock::now();
+    last = start;
     return;
 }
 
 void Stopwatch::StampLaunch(){
-    char* dt = std::ctime(&tici);
+    time_t launch = std::time(0);
+    char* dt = std::ctime(&launch);
     std::cout << "Simulation launched: " << dt;
     return;   
 }
 
 void Stopwatch::StampComplete(){
     time_t lap = std::time(0);
-    char* dt = std::ctime(&lap);
+    char dt[32];
+    ctime_r(&lap, dt); // (ensemble replicas stamp from several threads)
     std::cout << "Task completed: " << dt;
-    double elapsed = std::difftime(lap, ticlast);
+    auto now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(now - last).count();
     std::cout << "Elapsed time: " << elapsed << " sec" << std::endl;
-    ticlast = lap;
+    last = now;
     return;
 }
 
 void Stopwatch::EndStamp(){
-    ticf = std::time(0);
-    char* dt = std::ctime(&ticf);
+    time_t finish = std::time(0);
+    char* dt = std::ctime(&finish);
     std::cout << "Simulation finished: " << dt;
-    double elapsed = std::difftime(ticf, tici);
+    double elapsed = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
     std::cout << "Total Elapsed time: " << elapsed << " sec" << std::endl;
     return;
 }
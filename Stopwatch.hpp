@@ -3,12 +3,15 @@ Glassy Dynamics Simulation Module: Stopwatch
 Created by Joe Raso, Fri Jun 14 16:38:37 MDT 2019
 Copyright © 2019 Joe Raso, All rights reserved.
 
-Rudementary clocking functions for the simulation.
+Rudementary clocking functions for the simulation. The stamps give the date
+and time; the elapsed times are taken from the steady clock, to the
+nanosecond (see Profiler for timing the stages of a run in detail).
 */
 
 #ifndef Stopwatch_hpp
 #define Stopwatch_hpp
 
+#include <chrono>
 #include <ctime>
 #include <iostream>
 
@@ -19,7 +22,7 @@ class Stopwatch{
         void StampComplete();
         void EndStamp();
     protected:
-        time_t tici, ticf, ticlast;
+        std::chrono::steady_clock::time_point start, last;
 };
 
 #endif /*Stopwatch_hpp*/
@@ -0,0 +1,163 @@
+/*
+Glassy Dynamics Simulation Module: Tables
+Created by Joe Raso, Sat Oct 17 21:40:10 UTC 2026
+Copyright © 2019 Joe Raso, All rights reserved.
+*/
+
+#include "Tables.hpp"
+
+/* Shapes ------------------------------------------------------------------- */
+
+double PairTable::Shape(const std::string& shape, double eps, double sigma2,
+                        double r2, double& fij){
+    /* The pair energy at r2 for the named shape, without any cutoff or shift,
+    setting fij = -U'(r)/(48 r). */
+    double s2, s6, r, x, e;
+    if(shape == "lj" || shape == "wca"){
+        s2 = sigma2/r2;
+        s6 = s2*s2*s2;
+        fij = eps*s6*(s6-0.5)/r2;
+        return 4*eps*s6*(s6-1) + ((shape == "wca") ? eps : 0);
+    }
+    if(shape == "harmonic"){
+        r = sqrt(r2);
+        x = 1 - r/sqrt(sigma2);
+        fij = eps*x/(48*r*sqrt(sigma2));
+        return 0.5*eps*x*x;
+    }
+    // inverse power laws, "ipl" being ipl12
+    double n = (shape.size() > 3) ? std::stod(shape.substr(3)) : 12;
+    e = eps*pow(sigma2/r2, 0.5*n);
+    fij = n*e/(48*r2);
+    return e;
+}
+
+bool PairTable::Known(const std::string& shape){
+    /* Whether the named shape is one of the above. */
+    if(shape == "lj" || shape == "wca" || shape == "harmonic"){return true;}
+    if(shape.compare(0, 3, "ipl") != 0){return false;}
+    if(shape.size() == 3){return true;}
+    return shape.find_first_not_of("0123456789.", 3) == std::string::npos;
+}
+
+double PairTable::Range(const std::string& shape, double rc){
+    if(shape == "wca"){return pow(2.0, 1.0/6.0);}
+    if(shape == "harmonic"){return 1.0;}
+    return rc;
+}
+
+/* Building the tables ------------------------------------------------------ */
+
+void PairTable::Spline(const std::vector<double>& y, double slope0,
+                       double slope1, double h, double* c){
+    /* Fits the clamped cubic spline through the knots y (a step h apart,
+    with the given slopes at the ends), and puts the cubic of each bin, in
+    powers of the place u within it, into c[8m], ..., c[8m+3]. The second
+    derivatives at the knots come from the usual tridiagonal system, solved
+    by elimination. */
+    int k, n = int(y.size()) - 1;
+    std::vector<double> diag(n+1), rhs(n+1), M(n+1);
+    double off = h/6, w;
+    // the system, with off diagonal h/6 throughout
+    diag[0] = h/3;
+    rhs[0] = (y[1] - y[0])/h - slope0;
+    for(k=1;k<n;k++){
+        diag[k] = 2*h/3;
+        rhs[k] = (y[k+1] - 2*y[k] + y[k-1])/h;
+    }
+    diag[n] = h/3;
+    rhs[n] = slope1 - (y[n] - y[n-1])/h;
+    // eliminating below the diagonal, then substituting back
+    for(k=1;k<=n;k++){
+        w = off/diag[k-1];
+        diag[k] -= w*off;
+        rhs[k] -= w*rhs[k-1];
+    }
+    M[n] = rhs[n]/diag[n];
+    for(k=n-1;k>=0;k--){M[k] = (rhs[k] - off*M[k+1])/diag[k];}
+    // the cubic of each bin
+    for(k=0;k<n;k++){
+        c[8*k] = y[k];
+        c[8*k+1] = (y[k+1] - y[k]) - h*h*(2*M[k] + M[k+1])/6;
+        c[8*k+2] = h*h*M[k]/2;
+        c[8*k+3] = h*h*(M[k+1] - M[k])/6;
+    }
+    return;
+}
+
+void PairTable::Build(const std::string& name, int nbins, int n,
+                      const double* eps, const double* sig2,
+                      const double* rcut2, const double* shift){
+    /* Tabulates the energy and force of every species pair from the lower
+    end of its table out to its cutoff. The slopes at the ends, for the
+    clamped splines, are taken by central differences. */
+    int t, k;
+    double h, d, fp, fm;
+    shape = name;
+    bins = nbins;
+    ntypes = n;
+    epsilon.assign(eps, eps + n*n);
+    sigma2.assign(sig2, sig2 + n*n);
+    upper.assign(rcut2, rcut2 + n*n);
+    eshift.assign(shift, shift + n*n);
+    lower.assign(n*n, 0);
+    scale.assign(n*n, 0);
+    coefficients.assign(8*n*n*bins, 0);
+    double rmin = 0.5;
+    std::vector<double> e(bins+1), f(bins+1);
+    for(t=0;t<n*n;t++){
+        if(!(upper[t] < HUGE_VAL)){
+            std::cout << "Error: tabulated potentials need a cutoff!"
+                      << std::endl;
+            exit(1);
+        }
+        lower[t] = rmin*rmin*sigma2[t];
+        h = (upper[t] - lower[t])/bins;
+        scale[t] = 1.0/h;
+        for(k=0;k<=bins;k++){
+            e[k] = Shape(shape, epsilon[t], sigma2[t], lower[t] + k*h,
+                         f[k]) - eshift[t];
+        }
+        d = 1e-3*h;
+        double de0 = (Shape(shape, epsilon[t], sigma2[t], lower[t] + d, fp)
+                      - Shape(shape, epsilon[t], sigma2[t], lower[t] - d, fm))
+                     /(2*d);
+        double df0 = (fp - fm)/(2*d);
+        double de1 = (Shape(shape, epsilon[t], sigma2[t], upper[t] + d, fp)
+                      - Shape(shape, epsilon[t], sigma2[t], upper[t] - d, fm))
+                     /(2*d);
+        double df1 = (fp - fm)/(2*d);
+        Spline(e, de0, de1, h, &coefficients[8*t*bins]);
+        Spline(f, df0, df1, h, &coefficients[8*t*bins + 4]);
+    }
+    return;
+}
+
+/* Accuracy ----------------------------------------------------------------- */
+
+void PairTable::Deviation(double& energy, double& force){
+    /* Checks the tables against the shape halfway between every pair of
+    knots, where a spline is furthest from them. */
+    int t, m;
+    double r2, e, fij, e0, f0;
+    Kernels::Table table = {};
+    table.tables = Coefficients();
+    table.tablemin = Lower();
+    table.tablescale = Scale();
+    table.tablebins = bins;
+    energy = 0;
+    force = 0;
+    for(t=0;t<ntypes*ntypes;t++){
+        if(epsilon[t] == 0){continue;}
+        for(m=0;m<bins;m++){
+            r2 = lower[t] + (m + 0.5)/scale[t];
+            e0 = Shape(shape, epsilon[t], sigma2[t], r2, f0) - eshift[t];
+            e = Kernels::Spline(table, t, r2, fij);
+            energy = std::max(energy,
+                              fabs(e - e0)/std::max(fabs(e0), epsilon[t]));
+            force = std::max(force, fabs(fij - f0)/
+                             std::max(fabs(f0), epsilon[t]/(48*sigma2[t])));
+        }
+    }
+    return;
+}
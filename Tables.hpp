@@ -0,0 +1,72 @@
+/*
+Glassy Dynamics Simulation Module: Tables
+Created by Joe Raso, Sat Oct 17 21:40:10 UTC 2026
+Copyright © 2019 Joe Raso, All rights reserved.
+
+This module contains "PairTable", cubic spline tables of the pair energy and
+force for every pair of species, which let the force loop run any pair
+potential at the same cost per pair. The tables are indexed by r^2, so no
+square root (or division) is needed to look a pair up: r^2 from the lower end
+of the table to the cutoff is cut into equal bins, and the energy U and the
+force, stored as fij = -U'(r)/(48 r) like in the kernels, are each a cubic in
+the place u within a bin. The cubics are a clamped cubic spline through the
+exact values at the bin edges, so both are smooth across the bins.
+
+The shapes, each scaled by the epsilon and sigma of the species pair:
+    lj        Lennard-Jones, 4 eps [(sigma/r)^12 - (sigma/r)^6]
+    wca       Weeks-Chandler-Andersen, the repulsive part of LJ: LJ + eps,
+              cut at 2^(1/6) sigma
+    harmonic  harmonic spheres, eps/2 (1 - r/sigma)^2, cut at sigma
+    ipl<n>    inverse power law, eps (sigma/r)^n ("ipl" for n = 12)
+lj and ipl are cut at the cutoff of the system, and all of them are shifted
+to 0 at their cutoff. The tables start at 0.5 sigma; closer pairs are
+extrapolated from the first bin.
+*/
+
+#ifndef Tables_hpp
+#define Tables_hpp
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Kernels.hpp"
+
+class PairTable{
+    /* Spline tables of one pair potential, for each species pair */
+    public:
+        // Constructor
+        PairTable(): bins(0), ntypes(0) {};
+        // The shape named, unshifted: returns the energy of pair parameters
+        // eps, sigma2 at r2, and sets fij to the force over 48 r
+        static double Shape(const std::string& shape, double eps,
+                            double sigma2, double r2, double& fij);
+        static bool Known(const std::string& shape);
+        // Range of the shape in units of sigma, given the cutoff rc (0 for
+        // none: lj and ipl then have no range, and can't be tabulated)
+        static double Range(const std::string& shape, double rc);
+        // Builds the tables of the ntypes*ntypes pairs, shifting each to 0 at
+        // its cutoff rcut2 with eshift, bins bins per pair
+        void Build(const std::string& shape, int bins, int ntypes,
+                   const double* epsilon, const double* sigma2,
+                   const double* rcut2, const double* eshift);
+        // Accessors, for Kernels::Table
+        inline const double* Coefficients(){return coefficients.data();};
+        inline const double* Lower(){return lower.data();};
+        inline const double* Scale(){return scale.data();};
+        inline int Bins(){return bins;};
+        // Largest deviations of the interpolated energy and force from the
+        // shape, halfway between the knots, relative to the larger of the
+        // exact value and the epsilon of the pair
+        void Deviation(double& energy, double& force);
+    protected:
+        std::string shape;
+        int bins, ntypes;
+        std::vector<double> coefficients, lower, scale;
+        std::vector<double> epsilon, sigma2, upper, eshift;
+        void Spline(const std::vector<double>& y, double slope0,
+                    double slope1, double h, double* c);
+};
+
+#endif /*Tables_hpp*/
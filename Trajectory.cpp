@@ -0,0 +1,264 @@
+/*
+Glassy Dynamics Simulation Module: Trajectory
+Created by Joe Raso, Sat Oct 17 20:47:38 UTC 2026
+Copyright © 2019 Joe Raso, All rights reserved.
+*/
+
+#include "Trajectory.hpp"
+
+void Trajectory::SetFormat(std::string fmt){
+    /* Chooses the file format: "f64" or "f32" binary, or "csv". */
+    if(fmt!="f64" && fmt!="f32" && fmt!="csv"){
+        std::cout << "Error: unknown trajectory format " << fmt << std::endl;
+        exit(1);
+    }
+    format = fmt;
+    return;
+}
+
+void Trajectory::SetFields(std::string which){
+    /* Chooses which of positions (r), velocities (v) and forces (f) are
+    written, e.g. "rv" or "rvf". */
+    fields = 0;
+    if(which.find('r')!=std::string::npos){fields |= TRAJ_POSITIONS;}
+    if(which.find('v')!=std::string::npos){fields |= TRAJ_VELOCITIES;}
+    if(which.find('f')!=std::string::npos){fields |= TRAJ_FORCES;}
+    if(fields==0){
+        std::cout << "Error: no trajectory fields in " << which << std::endl;
+        exit(1);
+    }
+    return;
+}
+
+std::vector<std::string> Trajectory::Files(){
+    std::vector<std::string> files;
+    const char* names[3] = {"rtraj.csv", "vtraj.csv", "ftraj.csv"};
+    if(format!="csv"){
+        files.push_back(directory + "traj.bin");
+    } else {
+        for(int q=0;q<3;q++){
+            if(fields & (1<<q)){files.push_back(directory + names[q]);}
+        }
+    }
+    return files;
+}
+
+void Trajectory::Open(Particles* system, double dt){
+    /* Opens the trajectory files for appending. A header is written to a new
+    binary file; an existing one has to match the system and settings. */
+    const char* names[3] = {"rtraj.csv", "vtraj.csv", "ftraj.csv"};
+    if(opened){return;}
+    if(format=="csv"){
+        for(int q=0;q<3;q++){
+            if(!(fields & (1<<q))){continue;}
+            csv[q].open(directory + names[q], std::ios::app);
+            // File check-stop
+            if(!csv[q].is_open()){
+                std::cout << "Error opening trajectory file " << names[q]
+                          << "!" << std::endl;
+                exit(1);
+            }
+        }
+    } else {
+        binary.open(directory + "traj.bin", std::ios::app|std::ios::binary);
+        // File check-stop
+        if(!binary.is_open()){
+            std::cout << "Error opening trajectory file!" << std::endl;
+            exit(1);
+        }
+        binary.seekp(0, std::ios::end);
+        if(binary.tellp()==0){
+            WriteHeader(system, dt);
+        } else {
+            // Checking an existing file before adding to it
+            std::ifstream old(directory + "traj.bin", std::ios::binary);
+            char magic[8];
+            int32_t head[3];
+            old.read(magic, 8);
+            old.read(reinterpret_cast<char*>(head), sizeof(head));
+            int32_t bytes = (format=="f32") ? 4 : 8;
+            if(std::string(magic, 8)!="GLSTRAJ1"
+               || head[0]!=int32_t(system->Number())
+               || head[1]!=bytes || head[2]!=fields){
+                std::cout << "Error: existing trajectory file does not match"
+                          << " this run!" << std::endl;
+                exit(1);
+            }
+        }
+    }
+    opened = true;
+    
+    // Setting up the frame ring and starting the writer thread
+    particles = system->Number();
+    if(nbuffers > 0){
+        int N = particles;
+        ring.resize(nbuffers);
+        for(int b=0;b<nbuffers;b++){
+            for(int q=0;q<3;q++){
+                if(fields & (1<<q)){ring[b].data[q] = Matrix(3, N);}
+            }
+        }
+        first = 0; pending = 0; stopping = false;
+        writer = std::thread(&Trajectory::Writer, this);
+    }
+    return;
+}
+
+void Trajectory::WriteHeader(Particles* system, double dt){
+    int32_t head[3];
+    double box[2];
+    int N = system->Number();
+    head[0] = N;
+    head[1] = (format=="f32") ? 4 : 8;
+    head[2] = fields;
+    box[0] = system->Length();
+    box[1] = dt;
+    std::vector<int32_t> species(N);
+    const int* ids = system->IDs();
+    for(int i=0;i<N;i++){species[ids[i]] = system->Species()[i];}
+    binary.write("GLSTRAJ1", 8);
+    binary.write(reinterpret_cast<const char*>(head), sizeof(head));
+    binary.write(reinterpret_cast<const char*>(box), sizeof(box));
+    binary.write(reinterpret_cast<const char*>(species.data()),
+                 sizeof(int32_t)*N);
+    return;
+}
+
+void Trajectory::WriteField(double** data, int N){
+    /* Writes the x, y and z rows of one (3 x N) particle array. */
+    for(int k=0;k<3;k++){
+        if(format=="f32"){
+            single.resize(N);
+            for(int i=0;i<N;i++){single[i] = float(data[k][i]);}
+            binary.write(reinterpret_cast<const char*>(single.data()),
+                         sizeof(float)*N);
+        } else {
+            binary.write(reinterpret_cast<const char*>(data[k]),
+                         sizeof(double)*N);
+        }
+    }
+    return;
+}
+
+void Trajectory::WriteCSV(std::ofstream& file, double** data, int N){
+    /* Writes one (3 x N) particle array as N comma delimited rows. */
+    for(int i=0;i<N;i++){
+        file << data[0][i] << "," << data[1][i] << "," << data[2][i] << "\n";
+    }
+    return;
+}
+
+void Trajectory::WriteFrame(double time, double** data[3], int N){
+    /* Writes one frame, given the (3 x N) arrays of each field. */
+    int q;
+    if(format=="csv"){
+        for(q=0;q<3;q++){
+            if(fields & (1<<q)){WriteCSV(csv[q], data[q], N);}
+        }
+        return;
+    }
+    binary.write(reinterpret_cast<const char*>(&time), sizeof(double));
+    for(q=0;q<3;q++){
+        if(fields & (1<<q)){WriteField(data[q], N);}
+    }
+    return;
+}
+
+void Trajectory::Write(Particles* system, double time){
+    /* Appends the current state of the system as the frame at the given
+    time. The files must already be open. The frame is copied into the next
+    free buffer of the ring (waiting for one if need be) and handed to the
+    writer thread. The particles are always written in the order of their
+    ids, whatever order the system has them in. */
+    Profiler::Scope scope(Profiler::Trajectory);
+    Profiler::Count(Profiler::Frames, 1);
+    int q, k, i, slot;
+    int N = system->Number();
+    const int* ids = system->IDs();
+    double** data[3] = {system->r, system->v, system->f};
+    if(nbuffers == 0 && system->Reordered()){
+        for(q=0;q<3;q++){
+            if(!(fields & (1<<q))){continue;}
+            if(sorted.data[q].Columns() != N){sorted.data[q] = Matrix(3, N);}
+            for(k=0;k<3;k++){
+                double* row = sorted.data[q].Data()[k];
+                for(i=0;i<N;i++){row[ids[i]] = data[q][k][i];}
+            }
+            data[q] = sorted.data[q].Data();
+        }
+    }
+    if(nbuffers == 0){
+        WriteFrame(time, data, N);
+        return;
+    }
+    {
+        std::unique_lock<std::mutex> hold(lock);
+        freed.wait(hold, [&]{return pending < nbuffers;});
+        slot = (first + pending) % nbuffers;
+    }
+    // The writer does not touch this slot until it is counted as pending
+    Frame& frame = ring[slot];
+    frame.time = time;
+    for(q=0;q<3;q++){
+        if(!(fields & (1<<q))){continue;}
+        for(k=0;k<3;k++){
+            double* row = frame.data[q].Data()[k];
+            for(i=0;i<N;i++){row[ids[i]] = data[q][k][i];}
+        }
+    }
+    {
+        std::lock_guard<std::mutex> hold(lock);
+        pending++;
+    }
+    ready.notify_one();
+    return;
+}
+
+void Trajectory::Writer(){
+    /* Main loop of the writer thread: writes out the pending frames in
+    order until told to stop with none left. */
+    double** data[3];
+    while(true){
+        std::unique_lock<std::mutex> hold(lock);
+        ready.wait(hold, [&]{return pending > 0 || stopping;});
+        if(pending == 0){return;}
+        Frame& frame = ring[first];
+        hold.unlock();
+        for(int q=0;q<3;q++){data[q] = frame.data[q].Data();}
+        WriteFrame(frame.time, data, particles);
+        hold.lock();
+        first = (first + 1) % nbuffers;
+        pending--;
+        freed.notify_all();
+    }
+}
+
+void Trajectory::Flush(){
+    /* Waits for the writer to finish the pending frames, then pushes
+    everything written so far out to the files. */
+    if(opened && nbuffers > 0){
+        std::unique_lock<std::mutex> hold(lock);
+        freed.wait(hold, [&]{return pending == 0;});
+    }
+    if(binary.is_open()){binary.flush();}
+    for(int q=0;q<3;q++){if(csv[q].is_open()){csv[q].flush();}}
+    return;
+}
+
+void Trajectory::Close(){
+    /* Writes out the pending frames, stops the writer thread and closes
+    the files. */
+    if(writer.joinable()){
+        {
+            std::lock_guard<std::mutex> hold(lock);
+            stopping = true;
+        }
+        ready.notify_one();
+        writer.join();
+        ring.clear();
+    }
+    if(binary.is_open()){binary.close();}
+    for(int q=0;q<3;q++){if(csv[q].is_open()){csv[q].close();}}
+    opened = false;
+    return;
+}
@@ -0,0 +1,107 @@
+/*
+Glassy Dynamics Simulation Module: Trajectory
+Created by Joe Raso, Sat Oct 17 20:47:38 UTC 2026
+Copyright © 2019 Joe Raso, All rights reserved.
+
+This module contains the trajectory writer. The files are opened on the first
+frame and stay open until the writer is closed, rather than being reopened for
+every frame.
+
+The default format is a compact binary file, traj.bin:
+
+  header:  char[8]  magic "GLSTRAJ1"
+           int32    N, number of particles
+           int32    bytes per value (4 = float32, 8 = float64)
+           int32    fields written: 1 = positions, 2 = velocities, 4 = forces
+           float64  box length
+           float64  timestep dt
+           int32[N] species of each particle
+  frames:  float64  time
+           then for each field written, in the order r, v, f:
+           x[N], y[N], z[N] in the chosen precision
+
+All values are in the byte order of the machine that wrote them. The old comma
+delimited rtraj.csv / vtraj.csv / ftraj.csv files (one row per particle) can
+still be written with the "csv" format. Either way the particles are written in
+the order of their ids (Particles::IDs), even if the system has reordered them.
+
+Writing is done by a background thread, so the integration does not wait on
+the disk. Each frame is copied into one of a ring of preallocated buffers and
+the integrator carries on; the writer thread turns the buffers into file
+output in order. If every buffer is still waiting to be written, Write blocks
+until one is free. Flush waits for the ring to drain.
+*/
+
+#ifndef Trajectory_hpp
+#define Trajectory_hpp
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Matrix.hpp"
+#include "Particles.hpp"
+
+// Field flags for the binary header
+#define TRAJ_POSITIONS 1
+#define TRAJ_VELOCITIES 2
+#define TRAJ_FORCES 4
+
+class Trajectory{
+    /* Writes frames of a particle system to the trajectory files */
+    public:
+        // Constructor
+        Trajectory(): format("f64"), fields(TRAJ_POSITIONS|TRAJ_VELOCITIES
+            |TRAJ_FORCES), directory("Data/"), opened(false), particles(0),
+            nbuffers(4),
+            first(0), pending(0), stopping(false) {};
+        ~Trajectory(){Close();};
+        // Settings, which take effect the next time the files are opened
+        void SetFormat(std::string fmt);
+        void SetFields(std::string which);
+        inline void SetDirectory(std::string dir){directory = dir;};
+        // Size of the frame ring (0 writes from the calling thread instead)
+        inline void SetBuffers(int n){nbuffers = n;};
+        inline std::string Format(){return format;};
+        inline bool IsOpen(){return opened;};
+        // The files written with the current settings
+        std::vector<std::string> Files();
+        // Writing
+        void Open(Particles* system, double dt);
+        void Write(Particles* system, double time);
+        void Flush();
+        void Close();
+    protected:
+        // A copy of one frame, waiting to be written
+        struct Frame {
+            double time;
+            Matrix data[3];
+        };
+        void WriteHeader(Particles* system, double dt);
+        void WriteFrame(double time, double** data[3], int N);
+        void WriteField(double** data, int N);
+        void WriteCSV(std::ofstream& file, double** data, int N);
+        void Writer();
+        std::string format;
+        int fields;
+        std::string directory;
+        bool opened;
+        std::ofstream binary, csv[3];
+        std::vector<float> single;
+        // The ring of frames, and the writer thread working through it
+        int particles, nbuffers, first, pending;
+        bool stopping;
+        std::vector<Frame> ring;
+        // The frame put back in id order, when writing without the ring
+        Frame sorted;
+        std::thread writer;
+        std::mutex lock;
+        std::condition_variable ready, freed;
+};
+
+#endif /*Trajectory_hpp*/
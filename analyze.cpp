@@ -0,0 +1,269 @@
+/*
+Glassy Dynamics Simulation Module: analyze
+Created by Joe Raso, Sat Oct 17 20:52:10 UTC 2026
+Copyright © 2019 Joe Raso, All rights reserved.
+
+Post-processing of binary trajectories (glassius-analyze). Computes the same
+outputs as CalculateFsk, CalculateGr, CalculateMSD and CalculateCvv in
+process.py - fsk.csv, gr.csv, msd.csv and cvv.csv, with the same columns -
+from the traj.bin file in the given directory. The trajectory is memory-mapped
+and walked frame by frame, so it never has to fit in memory.
+
+Usage: glassius-analyze [directory] [--threads n] [--sample s] [--bins b]
+                        [--max-lag m]
+    directory  where traj.bin is, and where the results go (default Data/)
+    threads    number of threads to spread the time lags over (default 1)
+    sample     frame spacing of the g(r) samples (default 100)
+    bins       number of g(r) bins (default 100)
+    max-lag    longest time lag in frames for fsk/msd/cvv (default: all)
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Matrix.hpp"
+#include "Pool.hpp"
+#include "Reader.hpp"
+
+namespace {
+
+void Save(std::string path, const std::vector<double>& x,
+          const std::vector<double>& mean, const std::vector<double>& var,
+          const std::vector<double>& counts){
+    /* Writes the columns the way numpy.savetxt does. */
+    FILE* out = fopen(path.c_str(), "w");
+    if(out == 0){
+        std::cout << "Error opening " << path << "!" << std::endl;
+        exit(1);
+    }
+    for(size_t n=0;n<x.size();n++){
+        fprintf(out, "%.18e,%.18e,%.18e,%.18e\n", x[n], mean[n], var[n],
+                counts[n]);
+    }
+    fclose(out);
+    return;
+}
+
+void Dynamics(Reader& traj, std::string dir, int maxlag){
+    /* Fs(k,t) and the MSD, in one sweep over the (lag, origin) pairs of
+    position frames. As in process.py, Fs(k,t) is averaged over time origins
+    for each particle and k-vector first, and its variance taken over those
+    3N averages; the MSD variance is over every (origin, particle) value. */
+    int T = traj.Frames();
+    int N = traj.Number();
+    double L = traj.Length();
+    int nlags = std::min(T, maxlag+1);
+    // Tri's k-vectors
+    const double kn[3][3] = {{3,3,10},{6,-9,1},{9,-6,-1}};
+    double kvec[3][3];
+    for(int q=0;q<3;q++){
+        for(int k=0;k<3;k++){kvec[q][k] = (2*M_PI/L)*kn[q][k];}
+    }
+    std::vector<double> fsk(nlags), fvar(nlags), msd(nlags), mvar(nlags);
+    std::vector<double> taxis(nlags), counts(nlags);
+
+    int nthreads = Pool::Size();
+    Pool::Parallel([&](int t){
+        int lag, o, i, k, q;
+        double d, dr[3], r2, sum, sumsq, phase, mean;
+        Matrix now(3, N), then(3, N);
+        std::vector<double> corr(3*N);
+        for(lag=t;lag<nlags;lag+=nthreads){
+            sum = 0; sumsq = 0;
+            std::fill(corr.begin(), corr.end(), 0.0);
+            for(o=0;o+lag<T;o++){
+                traj.Get(o, READ_POSITIONS, then.Data());
+                traj.Get(o+lag, READ_POSITIONS, now.Data());
+                for(i=0;i<N;i++){
+                    r2 = 0;
+                    for(k=0;k<3;k++){
+                        d = now.Data()[k][i] - then.Data()[k][i];
+                        dr[k] = d - L*std::round(d/L);
+                        r2 += dr[k]*dr[k];
+                    }
+                    sum += r2; sumsq += r2*r2;
+                    for(q=0;q<3;q++){
+                        phase = 0;
+                        for(k=0;k<3;k++){phase += kvec[q][k]*dr[k];}
+                        corr[q*N+i] += cos(phase);
+                    }
+                }
+            }
+            counts[lag] = T - lag;
+            taxis[lag] = traj.Time(lag) - traj.Time(0);
+            mean = sum/(double(N)*(T-lag));
+            msd[lag] = mean;
+            mvar[lag] = sumsq/(double(N)*(T-lag)) - mean*mean;
+            sum = 0; sumsq = 0;
+            for(i=0;i<3*N;i++){
+                corr[i] /= (T-lag);
+                sum += corr[i]; sumsq += corr[i]*corr[i];
+            }
+            fsk[lag] = sum/(3*N);
+            fvar[lag] = sumsq/(3*N) - fsk[lag]*fsk[lag];
+        }
+    });
+
+    // Fs(k,t) starts from the first non-zero lag
+    Save(dir + "msd.csv", taxis, msd, mvar, counts);
+    if(nlags > 1){
+        Save(dir + "fsk.csv",
+             std::vector<double>(taxis.begin()+1, taxis.end()),
+             std::vector<double>(fsk.begin()+1, fsk.end()),
+             std::vector<double>(fvar.begin()+1, fvar.end()),
+             std::vector<double>(counts.begin()+1, counts.end()));
+    }
+    return;
+}
+
+void Velocities(Reader& traj, std::string dir, int maxlag){
+    /* Velocity autocorrelation, with the variance over every (origin,
+    particle) value. */
+    int T = traj.Frames();
+    int N = traj.Number();
+    int nlags = std::min(T, maxlag+1);
+    std::vector<double> cvv(nlags), var(nlags), taxis(nlags), counts(nlags);
+
+    int nthreads = Pool::Size();
+    Pool::Parallel([&](int t){
+        int lag, o, i;
+        double vv, sum, sumsq, mean;
+        Matrix now(3, N), then(3, N);
+        for(lag=t;lag<nlags;lag+=nthreads){
+            sum = 0; sumsq = 0;
+            for(o=0;o+lag<T;o++){
+                traj.Get(o, READ_VELOCITIES, then.Data());
+                traj.Get(o+lag, READ_VELOCITIES, now.Data());
+                double** a = now.Data();
+                double** b = then.Data();
+                for(i=0;i<N;i++){
+                    vv = a[0][i]*b[0][i] + a[1][i]*b[1][i] + a[2][i]*b[2][i];
+                    sum += vv; sumsq += vv*vv;
+                }
+            }
+            counts[lag] = T - lag;
+            taxis[lag] = traj.Time(lag) - traj.Time(0);
+            mean = sum/(double(N)*(T-lag));
+            cvv[lag] = mean;
+            var[lag] = sumsq/(double(N)*(T-lag)) - mean*mean;
+        }
+    });
+    Save(dir + "cvv.csv", taxis, cvv, var, counts);
+    return;
+}
+
+void PairDistribution(Reader& traj, std::string dir, int sample, int res){
+    /* g(r) of the A particles (species 0), from every sample-th frame. Each
+    histogram is normalized by the ideal-gas count of its shell; the mean and
+    variance are over the sampled frames. */
+    int T = traj.Frames();
+    int N = traj.Number();
+    double L = traj.Length();
+    std::vector<int> A;
+    for(int i=0;i<N;i++){if(traj.Species()[i]==0){A.push_back(i);}}
+    int Na = int(A.size());
+    double rho = Na/(L*L*L);
+    double width = L/res;
+    std::vector<double> raxis(res), norm(res);
+    for(int b=0;b<res;b++){
+        raxis[b] = (b + 0.5)*width;
+        norm[b] = 2*M_PI*rho*(Na-1)*raxis[b]*raxis[b]*width;
+    }
+    std::vector<int> samples;
+    for(int s=0;s<T;s+=sample){samples.push_back(s);}
+    int ns = int(samples.size());
+    std::vector<std::vector<double> > G(ns, std::vector<double>(res, 0));
+
+    int nthreads = Pool::Size();
+    Pool::Parallel([&](int t){
+        int s, i, j, k, b;
+        double d, r2;
+        Matrix r(3, N);
+        for(s=t;s<ns;s+=nthreads){
+            traj.Get(samples[s], READ_POSITIONS, r.Data());
+            double** x = r.Data();
+            for(i=0;i<Na;i++){
+                for(j=i+1;j<Na;j++){
+                    r2 = 0;
+                    for(k=0;k<3;k++){
+                        d = x[k][A[i]] - x[k][A[j]];
+                        d -= L*std::round(d/L);
+                        r2 += d*d;
+                    }
+                    b = int(sqrt(r2)/width);
+                    if(b < res){G[s][b] += 1;}
+                }
+            }
+        }
+    });
+
+    std::vector<double> mean(res, 0), var(res, 0), counts(res, 0);
+    for(int b=0;b<res;b++){
+        for(int s=0;s<ns;s++){
+            counts[b] += G[s][b];
+            mean[b] += G[s][b]/norm[b];
+            var[b] += (G[s][b]/norm[b])*(G[s][b]/norm[b]);
+        }
+        mean[b] /= ns;
+        var[b] = var[b]/ns - mean[b]*mean[b];
+    }
+    Save(dir + "gr.csv", raxis, mean, var, counts);
+    return;
+}
+
+}
+
+int main(int argc, const char * argv[]) {
+
+    // Command line
+    std::string dir = "Data/";
+    int threads = 1, sample = 100, bins = 100, maxlag = -1;
+    for(int a=1;a<argc;a++){
+        std::string flag = argv[a];
+        if(flag.compare(0, 2, "--") != 0){dir = flag; continue;}
+        if(a+1 >= argc){
+            std::cout << "Error: no value given for " << flag << std::endl;
+            return 1;
+        }
+        int value = std::stoi(argv[++a]);
+        if(flag=="--threads"){threads = value;}
+        else if(flag=="--sample"){sample = value;}
+        else if(flag=="--bins"){bins = value;}
+        else if(flag=="--max-lag"){maxlag = value;}
+        else {
+            std::cout << "Error: unknown option " << flag << std::endl;
+            return 1;
+        }
+    }
+    if(dir.back() != '/'){dir += "/";}
+
+    Reader traj;
+    if(!traj.Open(dir + "traj.bin")){return 1;}
+    std::cout << "Trajectory: " << traj.Frames() << " frames of "
+              << traj.Number() << " particles" << std::endl;
+    if(traj.Frames() == 0){return 1;}
+    if(maxlag < 0){maxlag = traj.Frames();}
+    Pool::Start(threads);
+
+    if(traj.Has(READ_POSITIONS)){
+        std::cout << "\nCalculating Fsk and MSD..." << std::endl;
+        Dynamics(traj, dir, maxlag);
+        std::cout << "\nCalculating g(r)..." << std::endl;
+        PairDistribution(traj, dir, sample, bins);
+    } else {
+        std::cout << "No positions recorded, skipping Fsk, MSD and g(r)"
+                  << std::endl;
+    }
+    if(traj.Has(READ_VELOCITIES)){
+        std::cout << "\nCalculating Cvv..." << std::endl;
+        Velocities(traj, dir, maxlag);
+    } else {
+        std::cout << "No velocities recorded, skipping Cvv" << std::endl;
+    }
+
+    Pool::Stop();
+    return 0;
+}
@@ -0,0 +1,346 @@
+/*
+Glassy Dynamics Simulation Module: bench
+Created by Joe Raso, Sat Oct 17 21:13:00 UTC 2026
+Copyright © 2019 Joe Raso, All rights reserved.
+
+Benchmarks of the hot paths of the simulation (glassius-bench, run by "make
+bench"). Each benchmark is timed over a sweep of system sizes and thread
+counts:
+    fluid-forces      Fluid::UpdateForces
+    glass-forces      Glass::UpdateForces
+    glass-tabulated   the same with the LJ potential tabulated (4096 bins; only
+                      with a cutoff)
+    verlet            Verlet::Propigate on the glass
+    verlet-template   VerletT<GlassPotential>::Propigate, on a step that is
+                      not recorded (no potential energy)
+    brownian          Brownian::Propigate on the glass
+    thermalize        Particles::Thermalize
+    gaussian          chaos::gaussian, 3 draws per particle
+    gaussians         chaos::gaussians, one batch of 3 per particle
+    trajectory        Trajectory::Write of r, v and f, flushed to disk
+A benchmark is first run until one sample takes at least the minimum time,
+which fixes the number of steps per sample, and then sampled "repeats" times.
+The mean, standard deviation, minimum and median time per step are reported,
+along with the nanoseconds per particle per step and, for the benchmarks that
+evaluate forces, the pair interactions per second.
+
+The results go to a CSV file (one line per benchmark, size and thread count)
+and, if asked, a JSON file that also records the version of the code, so runs
+of different versions can be compared.
+
+Usage: glassius-bench [--sides 5,10,20,40] [--threads 1,2,...] [--repeats 5]
+                      [--min-time 0.1] [--cutoff 2.5] [--skin 0.3]
+                      [--kernel auto] [--output bench.csv] [--json file]
+                      [--dir Data/bench/]
+    sides     values of Nside (N = Nside^3) to sweep over
+    threads   pool sizes to sweep over (default: 1 and powers of 2 up to the
+              number of hardware threads)
+    repeats   samples per benchmark
+    min-time  minimum duration of one sample, in seconds
+    cutoff    LJ cutoff in units of sigma (0 = every pair)
+    skin      neighbor list skin (0 = no neighbor list)
+    kernel    pair kernel: auto/scalar/avx2/avx512
+    output    the CSV file
+    json      the JSON file (default: none)
+    dir       where the trajectory benchmark writes (removed afterwards)
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+#include "Integration.hpp"
+#include "Particles.hpp"
+#include "Pool.hpp"
+#include "Trajectory.hpp"
+#include "chaos.hpp"
+
+#ifndef GLASSIUS_VERSION
+#define GLASSIUS_VERSION "unknown"
+#endif
+
+namespace {
+
+struct Result {
+    std::string name;
+    int nside, N, threads;
+    long steps;            // steps per sample
+    double mean, std, min, median; // seconds per step
+    double pairs;          // pair interactions per step (0 if none)
+};
+
+double Now(){
+    /* Seconds on the monotonic clock. */
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::vector<int> List(std::string value){
+    /* Splits a comma separated list of integers. */
+    std::vector<int> list;
+    size_t start = 0, comma;
+    do {
+        comma = value.find(',', start);
+        list.push_back(std::stoi(value.substr(start, comma - start)));
+        start = comma + 1;
+    } while(comma != std::string::npos);
+    return list;
+}
+
+bool MakeDirectory(std::string path){
+    /* Makes the directory along with any missing parents. Returns false if
+    it still isn't there afterwards. */
+    struct stat info;
+    for(size_t slash=path.find('/', 1);slash!=std::string::npos;
+        slash=path.find('/', slash+1)){
+        mkdir(path.substr(0, slash).c_str(), 0755);
+    }
+    mkdir(path.c_str(), 0755);
+    return stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+Result Measure(std::string name, int nside, int threads, double pairs,
+               int repeats, double mintime,
+               const std::function<void()>& step,
+               const std::function<void()>& finish = nullptr){
+    /* Times the step, finishing each sample with "finish" (if given) inside
+    the timing. The steps per sample are doubled until a sample takes at
+    least mintime. */
+    Result result = {name, nside, nside*nside*nside, threads, 1, 0, 0, 0, 0,
+                     pairs};
+    auto sample = [&](long steps){
+        double start = Now();
+        for(long s=0;s<steps;s++){step();}
+        if(finish){finish();}
+        return Now() - start;
+    };
+    // warming up and calibrating
+    while(sample(result.steps) < mintime){result.steps *= 2;}
+    std::vector<double> times(repeats);
+    for(int q=0;q<repeats;q++){times[q] = sample(result.steps)/result.steps;}
+    for(int q=0;q<repeats;q++){result.mean += times[q]/repeats;}
+    for(int q=0;q<repeats;q++){
+        result.std += (times[q] - result.mean)*(times[q] - result.mean);
+    }
+    result.std = (repeats > 1) ? sqrt(result.std/(repeats - 1)) : 0;
+    std::sort(times.begin(), times.end());
+    result.min = times[0];
+    result.median = (repeats % 2) ? times[repeats/2]
+        : 0.5*(times[repeats/2-1] + times[repeats/2]);
+    printf("%-14s N = %6d  threads = %2d  %12.4g ns/particle/step",
+           name.c_str(), result.N, threads, 1e9*result.mean/result.N);
+    if(pairs > 0){printf("  %10.4g pairs/s", pairs/result.mean);}
+    printf("  (+/- %.2g%%)\n", 100*result.std/result.mean);
+    fflush(stdout);
+    return result;
+}
+
+void Sweep(int nside, int threads, int repeats, double mintime,
+           double cutoff, double skin, std::string kernel, std::string dir,
+           std::vector<Result>& results){
+    /* Runs every benchmark on systems of Nside^3 particles. */
+    double rho = 1000 / (9.4*9.4*9.4);
+    int N = nside*nside*nside;
+    auto setup = [&](Particles& system){
+        if(cutoff > 0){system.SetCutoff(cutoff);}
+        if(skin > 0){system.SetSkin(skin);}
+        system.SetKernel(kernel);
+    };
+
+    // Force loops
+    {
+        Fluid fluid(rho, 1.0, nside);
+        setup(fluid);
+        fluid.UpdateForces();
+        results.push_back(Measure("fluid-forces", nside, threads,
+                                  fluid.PairsPerEvaluation(), repeats, mintime,
+                                  [&]{fluid.UpdateForces();}));
+    }
+    Glass glass(rho, 5.0, nside);
+    setup(glass);
+    glass.UpdateForces();
+    results.push_back(Measure("glass-forces", nside, threads,
+                              glass.PairsPerEvaluation(), repeats, mintime,
+                              [&]{glass.UpdateForces();}));
+    if(cutoff > 0){
+        glass.SetPotential("lj", 4096);
+        results.push_back(Measure("glass-tabulated", nside, threads,
+                                  glass.PairsPerEvaluation(), repeats,
+                                  mintime, [&]{glass.UpdateForces();}));
+        glass.SetPotential("analytic", 0);
+    }
+
+    // Integrators (one and two force evaluations per step)
+    Verlet verlet(&glass, 5.0, 0.005, 1);
+    results.push_back(Measure("verlet", nside, threads,
+                              glass.PairsPerEvaluation(), repeats, mintime,
+                              [&]{verlet.Propigate();}));
+    VerletT<GlassPotential> verlett(&glass, 5.0, 0.005, 1);
+    verlett.SetMeasure(false);
+    results.push_back(Measure("verlet-template", nside, threads,
+                              glass.PairsPerEvaluation(), repeats, mintime,
+                              [&]{verlett.Propigate();}));
+    Brownian brownian(&glass, 0.5, 1.0, 0.00005, 1);
+    results.push_back(Measure("brownian", nside, threads,
+                              2*glass.PairsPerEvaluation(), repeats, mintime,
+                              [&]{brownian.Propigate();}));
+
+    // Thermostat and random numbers
+    results.push_back(Measure("thermalize", nside, threads, 0, repeats,
+                              mintime, [&]{glass.Thermalize(0.5);}));
+    chaos::State state = chaos::save();
+    double sink = 0;
+    results.push_back(Measure("gaussian", nside, threads, 0, repeats, mintime,
+                              [&]{
+        for(int i=0;i<3*N;i++){sink += chaos::gaussian(0.0, 1.0);}
+    }));
+    Matrix noise(3, N);
+    results.push_back(Measure("gaussians", nside, threads, 0, repeats,
+                              mintime, [&]{
+        uint64_t batch = chaos::batch();
+        Pool::Parallel([&](int t){
+            chaos::gaussians(noise.Data(), (t*N)/threads, ((t+1)*N)/threads,
+                             batch, 1.0);
+        });
+    }));
+    chaos::restore(state);
+    if(sink == 0.5){printf("\n");} // keeps the draws from being optimized out
+
+    // Trajectory output
+    {
+        Trajectory trajectory;
+        trajectory.SetDirectory(dir);
+        double time = 0;
+        trajectory.Open(&glass, 0.005);
+        results.push_back(Measure("trajectory", nside, threads, 0, repeats,
+                                  mintime, [&]{
+            trajectory.Write(&glass, time); time += 0.005;
+        }, [&]{trajectory.Flush();}));
+        std::vector<std::string> files = trajectory.Files();
+        trajectory.Close();
+        for(size_t q=0;q<files.size();q++){remove(files[q].c_str());}
+    }
+    return;
+}
+
+void SaveCSV(std::string path, const std::vector<Result>& results){
+    /* One line per result, with a header line naming the columns. */
+    FILE* out = fopen(path.c_str(), "w");
+    if(out == 0){
+        std::cout << "Error opening " << path << "!" << std::endl;
+        exit(1);
+    }
+    fprintf(out, "benchmark,nside,N,threads,steps,mean_s,std_s,min_s,"
+                 "median_s,ns_per_particle_step,pairs_per_s\n");
+    for(size_t n=0;n<results.size();n++){
+        const Result& r = results[n];
+        fprintf(out, "%s,%d,%d,%d,%ld,%.6e,%.6e,%.6e,%.6e,%.6e,%.6e\n",
+                r.name.c_str(), r.nside, r.N, r.threads, r.steps, r.mean,
+                r.std, r.min, r.median, 1e9*r.mean/r.N,
+                (r.pairs > 0) ? r.pairs/r.mean : 0.0);
+    }
+    fclose(out);
+    return;
+}
+
+void SaveJSON(std::string path, const std::vector<Result>& results,
+              int repeats, double cutoff, double skin, std::string kernel){
+    /* The results along with the version and settings of the run. */
+    FILE* out = fopen(path.c_str(), "w");
+    if(out == 0){
+        std::cout << "Error opening " << path << "!" << std::endl;
+        exit(1);
+    }
+    fprintf(out, "{\n  \"version\": \"%s\",\n  \"kernel\": \"%s\",\n"
+                 "  \"cutoff\": %g,\n  \"skin\": %g,\n  \"repeats\": %d,\n"
+                 "  \"results\": [\n", GLASSIUS_VERSION, kernel.c_str(),
+            cutoff, skin, repeats);
+    for(size_t n=0;n<results.size();n++){
+        const Result& r = results[n];
+        fprintf(out, "    {\"benchmark\": \"%s\", \"nside\": %d, \"N\": %d, "
+                     "\"threads\": %d, \"steps\": %ld, \"mean_s\": %.6e, "
+                     "\"std_s\": %.6e, \"min_s\": %.6e, \"median_s\": %.6e, "
+                     "\"ns_per_particle_step\": %.6e, \"pairs_per_s\": %.6e}"
+                     "%s\n", r.name.c_str(), r.nside, r.N, r.threads, r.steps,
+                r.mean, r.std, r.min, r.median, 1e9*r.mean/r.N,
+                (r.pairs > 0) ? r.pairs/r.mean : 0.0,
+                (n+1 < results.size()) ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+    fclose(out);
+    return;
+}
+
+}
+
+int main(int argc, const char * argv[]) {
+
+    // Command line
+    std::vector<int> sides = List("5,10,20,40");
+    std::vector<int> threads;
+    int repeats = 5;
+    double mintime = 0.1, cutoff = 2.5, skin = 0.3;
+    std::string kernel = "auto", output = "bench.csv", json = "";
+    std::string dir = "Data/bench/";
+    for(int a=1;a<argc;a++){
+        std::string flag = argv[a];
+        if(a+1 >= argc){
+            std::cout << "Error: no value given for " << flag << std::endl;
+            return 1;
+        }
+        std::string value = argv[++a];
+        if(flag=="--sides"){sides = List(value);}
+        else if(flag=="--threads"){threads = List(value);}
+        else if(flag=="--repeats"){repeats = std::max(1, std::stoi(value));}
+        else if(flag=="--min-time"){mintime = std::stod(value);}
+        else if(flag=="--cutoff"){cutoff = std::stod(value);}
+        else if(flag=="--skin"){skin = std::stod(value);}
+        else if(flag=="--kernel"){kernel = value;}
+        else if(flag=="--output"){output = value;}
+        else if(flag=="--json"){json = value;}
+        else if(flag=="--dir"){dir = value;}
+        else {
+            std::cout << "Error: unknown option " << flag << std::endl;
+            return 1;
+        }
+    }
+    if(dir.back() != '/'){dir += "/";}
+    // Directory check-stop (before anything is run)
+    if(!MakeDirectory(dir)){
+        std::cout << "Error: can't make the directory " << dir << std::endl;
+        return 1;
+    }
+    if(threads.empty()){
+        int hardware = std::max(1u, std::thread::hardware_concurrency());
+        for(int n=1;n<hardware;n*=2){threads.push_back(n);}
+        threads.push_back(hardware);
+    }
+
+    chaos::seed(1);
+    std::cout << "Glassius benchmarks, version " << GLASSIUS_VERSION
+              << std::endl;
+    std::vector<Result> results;
+    for(size_t t=0;t<threads.size();t++){
+        Pool::Start(threads[t]);
+        for(size_t s=0;s<sides.size();s++){
+            Sweep(sides[s], threads[t], repeats, mintime, cutoff, skin, kernel,
+                  dir, results);
+        }
+    }
+    Pool::Stop();
+
+    SaveCSV(output, results);
+    std::cout << "Results written to " << output;
+    if(json != ""){
+        SaveJSON(json, results, repeats, cutoff, skin, kernel);
+        std::cout << " and " << json;
+    }
+    std::cout << std::endl;
+    return 0;
+}
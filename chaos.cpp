@@ -9,29 +9,151 @@ All rights reserved.
 
 #include "chaos.hpp"
 
-void chaos::seed(double s){
-    /* Seeds the random number generator. */
-    std::cout << "Seeding random number generation with: " << s << std::endl;
-    //std::cout << "maximum random is: " << RAND_MAX << std::endl;
-    std::srand(s);
+namespace {
+
+// The shared generator state, and the state each thread draws from: the
+// shared one, unless the thread has been handed its own with use()
+chaos::State shared = {{0, 0}, 0, 0, 0, 0};
+thread_local chaos::State* current = &shared;
+
+// The sequential stream uses the batch number no batch will ever reach
+const uint64_t sequential = ~uint64_t(0);
+
+inline void philox(uint32_t c[4], const uint32_t k[2]){
+    /* Philox4x32-10: ten rounds of multiply-and-xor mixing of the counter c,
+    under the key k. The result replaces c. */
+    uint32_t k0 = k[0], k1 = k[1];
+    for(int round=0;round<10;round++){
+        uint64_t p0 = uint64_t(0xD2511F53)*c[0];
+        uint64_t p1 = uint64_t(0xCD9E8D57)*c[2];
+        uint32_t x0 = uint32_t(p1 >> 32) ^ c[1] ^ k0;
+        uint32_t x2 = uint32_t(p0 >> 32) ^ c[3] ^ k1;
+        c[0] = x0; c[1] = uint32_t(p1);
+        c[2] = x2; c[3] = uint32_t(p0);
+        k0 += 0x9E3779B9; k1 += 0xBB67AE85;
+    }
+    return;
+}
+
+inline void pair(uint64_t b, uint64_t n, double& u1, double& u2){
+    /* The two uniform (0,1) numbers at position n of batch b, with 53 random
+    bits each. */
+    uint32_t c[4] = {uint32_t(n), uint32_t(n >> 32),
+                     uint32_t(b), uint32_t(b >> 32)};
+    philox(c, current->key);
+    const double scale = 1.0/9007199254740992.0; // 2^-53
+    u1 = ((((uint64_t(c[0]) << 32) | c[1]) >> 11) + 0.5)*scale;
+    u2 = ((((uint64_t(c[2]) << 32) | c[3]) >> 11) + 0.5)*scale;
+    return;
+}
+
+}
+
+void chaos::seed(double s, int stream){
+    /* Seeds the random number generator of the calling thread. Different
+    streams with the same seed give independent numbers. */
+    std::cout << "Seeding random number generation with: " << s;
+    if(stream != 0){std::cout << " (stream " << stream << ")";}
+    std::cout << std::endl;
+    uint64_t k = uint64_t(int64_t(s));
+    current->key[0] = uint32_t(k);
+    current->key[1] = uint32_t(k >> 32) ^ uint32_t(stream);
+    current->draws = 0; current->batches = 0;
+    current->spare = false;
+    return;
+}
+
+void chaos::use(State* state){
+    /* Makes the calling thread draw from the given state from now on, or
+    from the shared state again if given 0. */
+    current = (state != 0) ? state : &shared;
     return;
 }
 
 double chaos::random(){
-    /* Standard random [0,1] number generation */
-    double r = double(std::rand()) / double(RAND_MAX);
+    /* Standard random (0,1) number generation */
+    double r, unused;
+    pair(sequential, current->draws++, r, unused);
     return r;
 }
 
 double chaos::gaussian(double mean, double std){
-    /* Draws random numbers from a gaussian using the box-muller method */
-    double r1 = chaos::random();
-    double r2 = chaos::random();
-    double z0 = sqrt(-2.0*log(r1))*cos(2.0*M_PI*r2);
-    //double z1 = sqrt(-2.0*log(r1))*sin(2.0*M_PI*r2);
+    /* Draws random numbers from a gaussian using the box-muller method. Each
+    pair of uniforms gives two gaussians; the second is saved for the next
+    call. */
+    if(current->spare){
+        current->spare = false;
+        return (current->second * std) + mean;
+    }
+    double r1, r2;
+    pair(sequential, current->draws++, r1, r2);
+    double rho = sqrt(-2.0*log(r1));
+    double z0 = rho*cos(2.0*M_PI*r2);
+    current->second = rho*sin(2.0*M_PI*r2);
+    current->spare = true;
     return (z0 * std) + mean;
 }
 
+uint64_t chaos::batch(){
+    /* Reserves the next batch number. */
+    return current->batches++;
+}
+
+void chaos::gaussians(double** out, int first, int last, uint64_t b,
+                      double std){
+    /* Fills out[k][i] with gaussians for the particles first <= i < last.
+    Number 3i+k of the batch is component k of particle i, and numbers 2m and
+    2m+1 are the two Box-Muller outputs of Philox block m. A block shared with
+    a particle outside the range is still drawn whole, so splitting the
+    particles up gives the same numbers. */
+    int i, k;
+    int64_t g, m;
+    double u1, u2, rho, z[2];
+    for(m=(3*int64_t(first))/2;2*m<3*int64_t(last);m++){
+        pair(b, m, u1, u2);
+        rho = std*sqrt(-2.0*log(u1));
+        z[0] = rho*cos(2.0*M_PI*u2);
+        z[1] = rho*sin(2.0*M_PI*u2);
+        for(g=2*m;g<2*m+2;g++){
+            i = int(g/3); k = int(g%3);
+            if(i >= first && i < last){out[k][i] = z[g-2*m];}
+        }
+    }
+    return;
+}
+
+void chaos::gaussians(double** out, const int* ids, int first, int last,
+                      uint64_t b, double std){
+    /* Fills out[k][i] with the gaussians gaussians() would give particle
+    ids[i], for first <= i < last: numbers 3 ids[i] to 3 ids[i]+2 of the
+    batch, which take two Philox blocks. */
+    int i, k;
+    int64_t g, m;
+    double u1, u2, rho, z[4];
+    for(i=first;i<last;i++){
+        g = 3*int64_t(ids[i]);
+        for(m=0;m<2;m++){
+            pair(b, g/2 + m, u1, u2);
+            rho = std*sqrt(-2.0*log(u1));
+            z[2*m] = rho*cos(2.0*M_PI*u2);
+            z[2*m+1] = rho*sin(2.0*M_PI*u2);
+        }
+        for(k=0;k<3;k++){out[k][i] = z[g%2 + k];}
+    }
+    return;
+}
+
+chaos::State chaos::save(){
+    /* The current state of the generator. */
+    return *current;
+}
+
+void chaos::restore(const State& state){
+    /* Puts the generator back in a saved state. */
+    *current = state;
+    return;
+}
+
 void chaos::test(int n){
     /* Draw random numbers and prints them to "chaostest.csv" */
     double r;
@@ -5,10 +5,22 @@ Joe Raso, Spring 2019
 Copyright © 2019 Joe Raso.
 All rights reserved.
 
-These modules contain the random number generation functions. Currently
-(6/4/19), these use the standard c++ library random functions, but are
-designed to be easily swapped out and edited for superior random number
-generation, if needed.
+These modules contain the random number generation functions. They are built
+on the Philox4x32-10 counter-based generator (Salmon et al., "Parallel random
+numbers: as easy as 1, 2, 3", SC11): each number is a fixed function of the
+seed and a counter, with no hidden state to advance. So a draw can be made
+from any thread, in any order, and still come out the same.
+
+random() and gaussian() draw in sequence from their own stream, as before.
+The noise for the integrators instead comes in batches: gaussians() fills the
+(3 x N) arrays with the numbers keyed by (seed, batch, particle, component),
+so the noise is the same however the particles are split between threads
+(or, keyed by particle ids, between processes).
+Every batch number is handed out once by batch().
+
+The generator state is shared by all threads, unless a thread is given a
+state of its own with use() - as each replica of an ensemble is, so the
+replicas draw independent numbers without getting in each other's way.
 
 */
 
@@ -18,16 +30,41 @@ generation, if needed.
 #include <iostream>
 #include <fstream>
 #include <cstdlib>
+#include <cstdint>
 #include <cmath>
 
 namespace chaos {
-    void seed(double);
-    //Seeds the random number generator.
+    // Everything a generator remembers: its key, the counters of the
+    // sequential stream and of the batches, and the spare gaussian
+    struct State {
+        uint32_t key[2];
+        uint64_t draws, batches;
+        int64_t spare;
+        double second;
+    };
+    void seed(double, int stream = 0);
+    //Seeds the random number generator, optionally picking one of many
+    //independent streams with the same seed.
+    void use(State*);
+    //Gives the calling thread its own generator state to draw from (0 goes
+    //back to the shared one).
     double random(); 
-    //Standard random [0,1] number generation
+    //Standard random (0,1) number generation
     double gaussian(double, double);
     //Draws random numbers from a gaussian with (mean, std)
     //using the box-muller method.
+    uint64_t batch();
+    //Reserves the next batch number for gaussians().
+    void gaussians(double**, int, int, uint64_t, double);
+    //Fills out[k][i] for the particles first <= i < last with gaussian
+    //numbers of the given std, keyed by the batch number.
+    void gaussians(double**, const int*, int, int, uint64_t, double);
+    //The same, but with the numbers of particle ids[i] going to i, so each
+    //particle gets its own noise whatever order they are stored in.
+    State save();
+    //The current state of the generator.
+    void restore(const State&);
+    //Puts the generator back in a saved state.
     void test(int);
     //Function for testing random number generations. prints "chaostest.csv"
     //to the Data folder.
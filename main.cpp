@@ -8,14 +8,42 @@ Copyright © 2019 Joe Raso, All rights reserved.
 #include <string>
 #include "chaos.hpp"
 #include "Stopwatch.hpp"
+#include "Pool.hpp"
+#include "Profiler.hpp"
 #include "Protocol.hpp"
+#ifdef GLASSIUS_MPI
+#include <mpi.h>
+#endif
+
+namespace {
+
+int Fail(){
+    /* The exit status of a run stopped by an error. Under MPI, every process
+    is taken down with this one. */
+#ifdef GLASSIUS_MPI
+    MPI_Abort(MPI_COMM_WORLD, 1);
+#endif
+    return 1;
+}
+
+}
 
 int main(int argc, const char * argv[]) {
 
+#ifdef GLASSIUS_MPI
+    // Every process runs the same protocol on its own slab of the box (see
+    // Domain.hpp); only the first one prints
+    MPI_Init(NULL, NULL);
+    int rank, processes;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &processes);
+    if(rank > 0){std::cout.rdbuf(NULL);}
+#endif
+
     // Check:
-    if(argc != 6){
+    if(argc < 6){
         std::cout << "Error: wrong number of command line inputs!" << std::endl;
-        return 1;
+        return Fail();
     }
 
     // Current command line arguments:
@@ -24,6 +52,108 @@ int main(int argc, const char * argv[]) {
     double relax = std::stod(argv[3]);
     int record = std::stoi(argv[4]);
     int JobID = std::stoi(argv[5]);
+    
+    // Optional flags, given as "--flag value" pairs after the inputs above
+    Protocol::Options options;
+    Checkpoint checkpoint;
+    int interval = 0;
+    std::string resume = "";
+    int replicas = 1;
+    bool average = false;
+    int batch = 0;
+    for(int a=6;a<argc;a++){
+        std::string flag = argv[a];
+        if(a+1 >= argc){
+            std::cout << "Error: no value given for " << flag << std::endl;
+            return Fail();
+        }
+        std::string value = argv[++a];
+        if(flag=="--cutoff"){options.cutoff = std::stod(value);}
+        else if(flag=="--skin"){options.skin = std::stod(value);}
+        else if(flag=="--threads"){options.threads = std::stoi(value);}
+        else if(flag=="--nside"){options.nside = std::stoi(value);}
+        else if(flag=="--reorder"){options.reorder = std::stoi(value);}
+        else if(flag=="--kernel"){options.kernel = value;}
+        else if(flag=="--precision"){options.precision = value;}
+        else if(flag=="--traj"){options.trajformat = value;}
+        else if(flag=="--traj-fields"){options.trajfields = value;}
+        else if(flag=="--traj-buffers"){options.trajbuffers = std::stoi(value);}
+        else if(flag=="--correlate"){options.corrstride = std::stoi(value);}
+        else if(flag=="--correlate-points"){
+            options.corrpoints = std::stoi(value);
+        }
+        else if(flag=="--gr"){options.grbins = std::stoi(value);}
+        else if(flag=="--checkpoint"){interval = std::stoi(value);}
+        else if(flag=="--resume"){resume = value;}
+        else if(flag=="--replicas"){replicas = std::stoi(value);}
+        else if(flag=="--ensemble-average"){average = std::stoi(value) != 0;}
+        else if(flag=="--batch"){batch = std::stoi(value);}
+        else if(flag=="--overdamped"){options.overdamped = value;}
+        else if(flag=="--potential"){options.potential = value;}
+        else if(flag=="--table-bins"){options.tablebins = std::stoi(value);}
+        else if(flag=="--respa"){options.respa = std::stoi(value);}
+        else if(flag=="--respa-split"){options.respasplit = std::stod(value);}
+        else if(flag=="--respa-width"){options.respawidth = std::stod(value);}
+        else if(flag=="--templated"){options.templated = std::stoi(value) != 0;}
+        else if(flag=="--tempering-top"){
+            options.temperingtop = std::stod(value);
+        }
+        else if(flag=="--tempering-swap"){
+            options.temperingswap = std::stoi(value);
+        }
+        else if(flag=="--mc-accept"){options.mcaccept = std::stod(value);}
+        else if(flag=="--profile"){Profiler::Enable(std::stoi(value) != 0);}
+        else if(flag=="--trace"){Profiler::SetTrace(value);}
+        else if(flag=="--perf"){Profiler::SetHardware(std::stoi(value) != 0);}
+        else {
+            std::cout << "Error: unknown option " << flag << std::endl;
+            return Fail();
+        }
+    }
+
+    // Checkpointing every so many recording cycles, and/or resuming
+    if(replicas > 1 && (interval > 0 || resume != "")){
+        std::cout << "Error: ensembles can't be checkpointed!" << std::endl;
+        return Fail();
+    }
+    if(batch > 0 && (replicas > 1 || interval > 0 || resume != ""
+                     || mode != 0)){
+        std::cout << "Error: batches only run the KA test, without "
+                  << "--replicas or checkpoints!" << std::endl;
+        return Fail();
+    }
+    if(mode == 3 && (replicas < 2 || options.temperingtop <= T
+                     || options.temperingswap < 1)){
+        std::cout << "Error: parallel tempering needs --replicas of 2 or"
+                  << " more, a --tempering-top above T and a positive"
+                  << " --tempering-swap!" << std::endl;
+        return Fail();
+    }
+    if(options.respa > 1 && record%options.respa != 0){
+        std::cout << "Error: the recording interval has to be a multiple of"
+                  << " --respa!" << std::endl;
+        return Fail();
+    }
+#ifdef GLASSIUS_MPI
+    if(processes > 1 && (mode > 1 || replicas > 1 || batch > 0
+                         || interval > 0 || resume != ""
+                         || options.respa > 1 || options.corrstride > 0
+                         || options.grbins > 0 || options.reorder > 0
+                         || options.potential != "analytic"
+                         || options.precision != "double")){
+        std::cout << "Error: runs split over processes only take the KA and"
+                  << " Szamel tests, with analytic double precision forces"
+                  << " and without r-RESPA, correlators, g(r), ensembles,"
+                  << " batches, checkpoints or reordering!" << std::endl;
+        return Fail();
+    }
+    std::cout << "MPI processes = " << processes << std::endl;
+#endif
+    if(interval > 0 || resume != ""){
+        checkpoint.SetInterval(interval);
+        if(resume != "" && !checkpoint.Load(resume)){return Fail();}
+        options.checkpoint = &checkpoint;
+    }
 
     // start the clock
     Stopwatch timer;
@@ -32,16 +162,41 @@ int main(int argc, const char * argv[]) {
     // seed the random number generator
     chaos::seed(JobID);
     
+    // start the worker threads
+    Pool::Start(options.threads);
+    
     // running the protocol
     
-    if (mode==0) {Protocol::KobAndersonTest(T, relax, record, &timer);};
-    if (mode==1) {Protocol::SzamelTest(T, relax, record, &timer);};
-    //Protocol::LennardJonesTest(5.0 ,1000, &timer);
-    //Protocol::DiffusionTest(T, relax, &timer);
-    //Protocol::KobAndersonReplication(T, relax, &timer);
+    if (batch > 0) {
+        Protocol::BatchTest(batch, T, relax, record, JobID, &timer, &options);
+    } else if (mode == 3) {
+        Protocol::ParallelTempering(replicas, T, relax, record, JobID, &timer,
+                                    &options);
+    } else if (replicas > 1) {
+        Protocol::Ensemble(mode, replicas, T, relax, record, JobID, average,
+                           &timer, &options);
+    } else {
+        if (mode==0) {Protocol::KobAndersonTest(T, relax, record, &timer,
+                                                &options);};
+        if (mode==1) {Protocol::SzamelTest(T, relax, record, &timer,
+                                           &options);};
+        if (mode==2) {Protocol::OverdampedValidation(T, relax, record,
+                                                     &timer, &options);};
+        if (mode==4) {Protocol::MonteCarloTest(T, relax, record, &timer,
+                                               &options);};
+    }
+    //Protocol::LennardJonesTest(5.0 ,1000, &timer, &options);
+    //Protocol::DiffusionTest(T, relax, &timer, &options);
+    //Protocol::KobAndersonReplication(T, relax, &timer, &options);
     
     // timestamping the end
     timer.EndStamp();
+    Pool::Stop();
+    Profiler::Summary();
+    Profiler::WriteTrace();
+#ifdef GLASSIUS_MPI
+    MPI_Finalize();
+#endif
     
     return 0;
 }